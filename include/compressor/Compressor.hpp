@@ -10,6 +10,9 @@ namespace SZ {
         public:
             virtual T *decompress(uchar const *compressed_data, size_t length) = 0;
 
+            // into dec_data, which the caller allocates for all the elements, returns dec_data
+            virtual T *decompress(uchar const *compressed_data, size_t length, T *dec_data) = 0;
+
             virtual uchar *compress(T *data, size_t &compressed_size) = 0;
         };
     }
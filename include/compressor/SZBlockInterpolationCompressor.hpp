@@ -11,12 +11,24 @@
 #include "utils/Config.hpp"
 #include "utils/FileUtil.h"
 #include "utils/Interpolators.hpp"
+#include "utils/InterpolatorsSIMD.hpp"
+#include "utils/Workspace.hpp"
+#include "utils/OutputArena.hpp"
+#include "utils/Timer.hpp"
+#include "utils/CompressionStats.hpp"
+#include "quantizer/IntegerQuantizer.hpp"
 #include "def.hpp"
 #include <cstring>
 #include <cmath>
+#include <stdexcept>
+#include <string>
 #include <predictor/RegressionPredictor.hpp>
 #include <predictor/ComposedPredictor.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace SZ {
     template<class T, uint N, class Predictor, class Quantizer, class Encoder, class Lossless>
     class SZBlockInterpolationCompressor {
@@ -30,8 +42,6 @@ namespace SZ {
                 predictor(predictor), quantizer(quantizer), encoder(encoder), lossless(lossless),
                 block_size(conf.block_size), stride(conf.stride),
                 global_dimensions(conf.dims), num_elements(conf.num),
-//                interpolators({"linear", "cubic", "cubic2", "akima", "pchip"}),
-                interpolators({"linear", "cubic"}),
                 interpolator_op(interpolator), direction_op(direction), interp_level(interpo_level) {
             static_assert(std::is_base_of<concepts::PredictorInterface<T, N>, Predictor>::value,
                           "must implement the predictor interface");
@@ -45,302 +55,588 @@ namespace SZ {
         }
 
 
-        T *decompress(uchar *compressed_data, const size_t length, bool pre_de_lossless = false) {
+        T *decompress(uchar const *compressed_data, const size_t length, bool pre_de_lossless = false) {
+            load_stream(compressed_data, length, pre_de_lossless);
+            return reconstruct(new T[num_elements]);
+        }
+
+        // decompress into dec_data, allocated by the caller for all the elements, returns dec_data;
+        // the lossless buffer and the indices are kept by the compressor for the next call
+        T *decompress(uchar const *compressed_data, const size_t length, T *dec_data) {
+            load_stream(compressed_data, length, false);
+            return reconstruct(dec_data);
+        }
+
+        // scratch memory of decompression, kept between calls
+        Workspace &get_workspace() {
+            return workspace;
+        }
+
+        // what the last compression or decompression measured
+        const CompressionStats &get_stats() const {
+            return stats;
+        }
+
+        // print the predictor and the statistics at the end of every call, nothing is printed otherwise
+        void set_verbose(bool print) {
+            verbose = print;
+        }
+
+        bool get_verbose() const {
+            return verbose;
+        }
+
+        // Cut the blocks into batches of whole rows of blocks along the first dimension holding at least
+        // this many elements. A batch has its own predictor and unpredictable data and reads nothing from
+        // the others, so threads can work on different batches; blocks at the start of a batch lose their
+        // neighbors before. 0 keeps all the blocks in one batch with the serial stream.
+        // The batches are stored in the stream, the decompressor does not need the setting.
+        void set_batch_elements(size_t elements) {
+            batch_elements = elements;
+        }
+
+        size_t get_batch_elements() const {
+            return batch_elements;
+        }
+
+        // number of threads working on different batches, the output does not depend on it
+        void set_num_threads(int threads) {
+            num_threads = threads > 0 ? threads : 1;
+        }
+
+        int get_num_threads() const {
+            return num_threads;
+        }
+
+        // forget the predictor data, the unpredictable data and the indices of the previous calls,
+        // keeping their memory; compress starts with it, so one compressor serves many fields
+        void reset() {
+            predictor.clear();
+            fallback_predictor.clear();
+            quantizer.clear();
+            quant_inds.clear();
+            quant_index = 0;
+        }
+
+        // Set every block up the way compress does without predicting it: its extent, its number of levels and
+        // the range of the points interpolation starts from. Returns the sum of the first of these points and
+        // the levels over the blocks, so test_block_setup can time the setup alone and check it.
+        double setup_blocks(T *data) {
+            auto inter_block_range = batch_range(data, 0, block_rows());
+            multi_dimensional_range<T, N> stationary_range(data, std::begin(global_dimensions),
+                                                           std::end(global_dimensions), 1, 0);
+            std::array<size_t, N> block_dims, end_idx;
+            double checksum = 0;
+            auto inter_end = inter_block_range.end();
+            for (auto block = inter_block_range.begin(); block != inter_end; ++block) {
+                uint levels = std::min(interp_level, block_extent(block.get_global_index(), block_dims, end_idx));
+                set_stationary_range(stationary_range, block, block_dims, levels);
+                checksum += *stationary_range.begin() + levels;
+            }
+            return checksum;
+        }
+
+    private:
+        struct batch_tag {
+        };
+
+        // the settings of other without its data, the compressor of one batch; the predictor is cloned,
+        // so the batches on other threads do not share the predictors a ComposedPredictor is made of
+        SZBlockInterpolationCompressor(const SZBlockInterpolationCompressor &other, batch_tag) :
+                interpolator_op(other.interpolator_op), direction_op(other.direction_op),
+                sz_eb_ratio(other.sz_eb_ratio), interp_level(other.interp_level),
+                predictor(*std::static_pointer_cast<Predictor>(other.predictor.clone())),
+                fallback_predictor(other.fallback_predictor),
+                quantizer(other.quantizer), encoder(other.encoder), lossless(other.lossless),
+                block_size(other.block_size), stride(other.stride), num_elements(other.num_elements),
+                global_dimensions(other.global_dimensions), dimension_offsets(other.dimension_offsets),
+                direction_sequence(other.direction_sequence) {
+            reset();
+        }
+
+        SZBlockInterpolationCompressor batch_worker() const {
+            return SZBlockInterpolationCompressor(*this, batch_tag());
+        }
+
+        // rows of blocks along the first dimension
+        size_t block_rows() const {
+            return (global_dimensions[0] - 1) / block_size + 1;
+        }
+
+        // blocks and elements of a full row of blocks
+        size_t row_blocks() const {
+            size_t blocks = 1;
+            for (uint i = 1; i < N; i++) {
+                blocks *= (global_dimensions[i] - 1) / block_size + 1;
+            }
+            return blocks;
+        }
+
+        size_t row_elements() const {
+            return block_size * dimension_offsets[0];
+        }
+
+        // rows of blocks of a batch of the current stream, from batch_elements at compression and from
+        // the stream at decompression; 0 if the stream is not batched
+        size_t rows_per_batch() const {
+            return batch_rows;
+        }
+
+        size_t num_batches() const {
+            return (block_rows() - 1) / batch_rows + 1;
+        }
+
+        // the blocks of rows [first_row, end_row); the first row starts the range, so predictors do not read
+        // the blocks before it
+        multi_dimensional_range<T, N> batch_range(T *data, size_t first_row, size_t end_row) {
+            multi_dimensional_range<T, N> range(data, std::begin(global_dimensions), std::end(global_dimensions),
+                                               block_size, 0);
+            auto dims = range.get_dimensions();
+            dims[0] = end_row - first_row;
+            range.set_dimensions(dims.begin(), dims.end());
+            range.set_offsets(first_row * row_elements());
+            return range;
+        }
+
+        // ceil(log2(n)) for n >= 1, on integers
+        static uint ceil_log2(size_t n) {
+            return n > 1 ? 64 - __builtin_clzll(n - 1) : 0;
+        }
+
+        // the size and last point of the block starting at block_idx, returns its number of levels, at least 1
+        uint block_extent(const std::array<size_t, N> &block_idx, std::array<size_t, N> &block_dims,
+                          std::array<size_t, N> &end_idx) const {
+            uint levels = 1;
+            for (uint i = 0; i < N; i++) {
+                block_dims[i] = std::min<size_t>(block_size, global_dimensions[i] - block_idx[i]);
+                end_idx[i] = block_idx[i] + block_dims[i] - 1;
+                levels = std::max(levels, ceil_log2(block_dims[i]));
+            }
+            return levels;
+        }
+
+        // point the range at the grid interpolation of the block starts from, one point every 2^levels;
+        // a single range serves all the blocks so that the traversal allocates nothing
+        void set_stationary_range(multi_dimensional_range<T, N> &range,
+                                  const typename multi_dimensional_range<T, N>::iterator &block,
+                                  const std::array<size_t, N> &block_dims, uint levels) const {
+            std::array<size_t, N> dims;
+            for (uint i = 0; i < N; i++) {
+                dims[i] = ((block_dims[i] - 1) >> levels) + 1;
+            }
+            range.set_access_stride((size_t) 1 << levels);
+            range.set_global_dim_strides();
+            range.set_dimensions(dims.begin(), dims.end());
+            range.set_offsets(block.get_offset());
+            range.set_starting_position(block.get_local_index());
+        }
+
+        // quantize or recover the points of the range with the predictor of the block or the fallback one;
+        // the loops are made for each of them, so predict is not a virtual call
+        void quantize_range(bool block_predictor, multi_dimensional_range<T, N> &range) {
+            if (block_predictor) {
+                quantize_range_with(predictor, range);
+            } else {
+                quantize_range_with(fallback_predictor, range);
+            }
+        }
+
+        void recover_range(bool block_predictor, multi_dimensional_range<T, N> &range) {
+            if (block_predictor) {
+                recover_range_with(predictor, range);
+            } else {
+                recover_range_with(fallback_predictor, range);
+            }
+        }
+
+        template<class P>
+        void quantize_range_with(P &range_predictor, multi_dimensional_range<T, N> &range) {
+            auto range_end = range.end();
+            for (auto element = range.begin(); element != range_end; ++element) {
+                quant_inds.push_back(quantizer.quantize_and_overwrite(*element, range_predictor.P::predict(element)));
+            }
+        }
+
+        template<class P>
+        void recover_range_with(P &range_predictor, multi_dimensional_range<T, N> &range) {
+            auto range_end = range.end();
+            for (auto element = range.begin(); element != range_end; ++element) {
+                *element = quantizer.recover(range_predictor.P::predict(element), dec_inds[quant_index++]);
+            }
+        }
+
+        // read the header, the quantization indices and the block selection
+        void load_stream(uchar const *compressed_data, const size_t length, bool pre_de_lossless) {
             size_t remaining_length = length;
-            uchar *lossless_decompressed;
             uchar const *compressed_data_pos;
+            stats.clear();
+            stats.compressed_bytes = length;
+            Timer timer(true);
             if (pre_de_lossless) {
                 compressed_data_pos = compressed_data;
             } else {
-                lossless_decompressed = lossless.decompress(compressed_data, remaining_length);
-                compressed_data_pos = lossless_decompressed;
+                compressed_data_pos = lossless.decompress(compressed_data, remaining_length, workspace, 0);
                 float eb;
                 read(eb, compressed_data_pos, remaining_length);
             }
+            stats.add_time("Lossless", timer.stop());
+            timer.start();
 
             read(global_dimensions.data(), N, compressed_data_pos, remaining_length);
             num_elements = 1;
             for (const auto &d : global_dimensions) {
                 num_elements *= d;
-                std::cout << d << " ";
             }
-            std::cout << std::endl;
             read(block_size, compressed_data_pos, remaining_length);
             stride = block_size;
-            predictor.load(compressed_data_pos, remaining_length);
-            quantizer.load(compressed_data_pos, remaining_length);
+            init_interpolation_order();
+            uchar batched = 0;
+            read(batched, compressed_data_pos, remaining_length);
+            batch_rows = 0;
+            if (batched) {
+                read(batch_rows, compressed_data_pos, remaining_length);
+                if (!batch_rows) {
+                    throw std::runtime_error("block stream has batches of no rows");
+                }
+            }
+            if (!batch_rows) {
+                predictor.load(compressed_data_pos, remaining_length);
+                quantizer.load(compressed_data_pos, remaining_length);
+            } else {
+                size_t batches = 0;
+                read(batches, compressed_data_pos, remaining_length);
+                if (batches != num_batches()) {
+                    throw std::runtime_error("block stream has " + std::to_string(batches) + " batches for " +
+                                             std::to_string(num_batches()));
+                }
+                section_ends.resize(batches);
+                read(section_ends.data(), batches, compressed_data_pos, remaining_length);
+                sections = compressed_data_pos;
+                compressed_data_pos += section_ends.back();
+                remaining_length -= section_ends.back();
+            }
             encoder.load(compressed_data_pos, remaining_length);
-            quant_inds = encoder.decode(compressed_data_pos, num_elements);
+            quant_inds.resize(num_elements);
+            encoder.decode(compressed_data_pos, num_elements, quant_inds.data());
+            quant_index = 0;
 
             encoder.postprocess_decode();
 
-            std::vector<int> block_selection;
             size_t selection_size = *reinterpret_cast<const size_t *>(compressed_data_pos);
             compressed_data_pos += sizeof(size_t);
             remaining_length -= sizeof(size_t);
             HuffmanEncoder<int> selection_encoder;
             selection_encoder.load(compressed_data_pos, remaining_length);
-            block_selection = selection_encoder.decode(compressed_data_pos, selection_size);
+            selected_blocks.resize(selection_size);
+            selection_encoder.decode(compressed_data_pos, selection_size, selected_blocks.data());
             selection_encoder.postprocess_decode();
+            stats.num_elements = num_elements;
+            stats.error_bound = quantizer.get_eb();
+            if (!batch_rows) {
+                stats.unpredictable = quantizer.get_unpred().size();
+            }
+            fill_selection(selected_blocks);
+            stats.add_time("Decoding", timer.stop());
+        }
 
-            if (!pre_de_lossless) {
-                lossless.postdecompress_data(lossless_decompressed);
+        T *reconstruct(T *dec_data) {
+            Timer timer(true);
+            if (!batch_rows) {
+                dec_inds = quant_inds.data();
+                quant_index = 0;
+                reconstruct_blocks(dec_data, 0, block_rows(), selected_blocks.data());
+                assert(quant_index == num_elements);
+            } else {
+                size_t rows = rows_per_batch();
+                size_t batches = num_batches();
+                size_t unpredictable = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads) reduction(+:unpredictable)
+                for (ptrdiff_t b = 0; b < (ptrdiff_t) batches; b++) {
+                    size_t first_row = b * rows;
+                    size_t end_row = std::min(first_row + rows, block_rows());
+                    size_t section_begin = b ? section_ends[b - 1] : 0;
+                    size_t section_length = section_ends[b] - section_begin;
+                    uchar const *section_pos = sections + section_begin;
+                    auto worker = batch_worker();
+                    worker.predictor.load(section_pos, section_length);
+                    worker.quantizer.load(section_pos, section_length);
+                    worker.dec_inds = quant_inds.data() + first_row * row_elements();
+                    worker.reconstruct_blocks(dec_data, first_row, end_row,
+                                              selected_blocks.data() + first_row * row_blocks());
+                    assert(worker.quant_index == (std::min(end_row * row_elements(), num_elements) -
+                                                  first_row * row_elements()));
+                    unpredictable += worker.quantizer.get_unpred().size();
+                }
+                stats.unpredictable = unpredictable;
             }
+            stats.add_time("Reconstruction", timer.stop());
+            report();
+
+            return dec_data;
+        }
 
-            auto dec_data = std::make_unique<T[]>(num_elements);
-            auto inter_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(dec_data.get(),
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions),
-                                                                                         block_size,
-                                                                                         0);
-            auto intra_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(dec_data.get(),
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions),
-                                                                                         1, 0);
+        // decompress the blocks of rows [first_row, end_row) along the first dimension, reading the indices from
+        // dec_inds and the choice of every block from selection
+        void reconstruct_blocks(T *dec_data, size_t first_row, size_t end_row, const int *selection) {
+            auto inter_block_range = batch_range(dec_data, first_row, end_row);
+            SZ::multi_dimensional_range<T, N> intra_block_range(dec_data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), 1, 0);
 
-            predictor.predecompress_data(inter_block_range->begin());
-            fallback_predictor.predecompress_data(inter_block_range->begin());
+            predictor.predecompress_data(inter_block_range.begin());
+            fallback_predictor.predecompress_data(inter_block_range.begin());
             quantizer.predecompress_data();
 
 //            debug.resize(num_elements, 0);
 
-            auto inter_begin = inter_block_range->begin();
-            auto inter_end = inter_block_range->end();
-            std::array<size_t, N> intra_block_dims;
+            auto inter_begin = inter_block_range.begin();
+            auto inter_end = inter_block_range.end();
+            SZ::multi_dimensional_range<T, N> interp_stationary_range(dec_data, std::begin(global_dimensions),
+                                                                      std::end(global_dimensions), 1, 0);
+            std::array<size_t, N> intra_block_dims, interp_end_idx;
             size_t block_idx = 0;
 
             for (auto block = inter_begin; block != inter_end; block++) {
                 auto block_global_idx = block.get_global_index();
-                auto interp_end_idx = block.get_global_index();
-                uint max_interp_level = 1;
-                for (int i = 0; i < N; i++) {
-                    intra_block_dims[i] = (block_global_idx[i] + block_size > global_dimensions[i]) ?
-                                          global_dimensions[i] - block_global_idx[i] : block_size;
-                    interp_end_idx[i] += intra_block_dims[i] - 1;
-                    if (max_interp_level < ceil(log2(intra_block_dims[i]))) {
-                        max_interp_level = (uint) ceil(log2(intra_block_dims[i]));
-                    }
-                }
-                intra_block_range->set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
-                intra_block_range->set_offsets(block.get_offset());
-                intra_block_range->set_starting_position(block.get_local_index());
+                uint max_interp_level = block_extent(block_global_idx, intra_block_dims, interp_end_idx);
+                intra_block_range.set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
+                intra_block_range.set_offsets(block.get_offset());
+                intra_block_range.set_starting_position(block.get_local_index());
 
-                if (block_selection[block_idx++] == 0) {
-                    concepts::PredictorInterface<T, N> *predictor_withfallback = &predictor;
-                    if (!predictor.predecompress_block(intra_block_range)) {
-                        predictor_withfallback = &fallback_predictor;
-                    }
-                    auto intra_begin = intra_block_range->begin();
-                    auto intra_end = intra_block_range->end();
-                    for (auto element = intra_begin; element != intra_end; ++element) {
-                        *element = quantizer.recover(predictor_withfallback->predict(element), quant_inds[quant_index++]);
-                    }
+                if (selection[block_idx++] == 0) {
+                    recover_range(predictor.predecompress_block(intra_block_range), intra_block_range);
                 } else {
                     if (!interp_level) {
-                        auto first = intra_block_range->begin();
-                        *first = quantizer.recover(fallback_predictor.predict(first), quant_inds[quant_index++]);
+                        auto first = intra_block_range.begin();
+                        *first = quantizer.recover(fallback_predictor.predict(first), dec_inds[quant_index++]);
                     } else {
-                        max_interp_level = interp_level;
-                        size_t stride_sz = 1U << max_interp_level;
-                        auto interp_stationary_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(
-                                dec_data.get(), std::begin(global_dimensions), std::end(global_dimensions), stride_sz, 0);
-                        std::array<size_t, N> interp_stationary_dims;
-                        for (int i = 0; i < N; i++) {
-                            interp_stationary_dims[i] = ceil(1.0 * intra_block_dims[i] / stride_sz);
-                        }
-                        interp_stationary_range->set_dimensions(interp_stationary_dims.begin(), interp_stationary_dims.end());
-                        interp_stationary_range->set_offsets(block.get_offset());
-                        interp_stationary_range->set_starting_position(block.get_local_index());
-                        concepts::PredictorInterface<T, N> *interp_stationary_predictor = &predictor;
-                        if (!predictor.predecompress_block(intra_block_range)) {
-                            interp_stationary_predictor = &fallback_predictor;
-                        }
-                        for (auto element = interp_stationary_range->begin();
-                             element != interp_stationary_range->end(); ++element) {
-                            *element = quantizer.recover(interp_stationary_predictor->predict(element),
-                                                         quant_inds[quant_index++]);
-//                            debug[element.get_offset()]++;
-                        }
-//                            std::cout << "quan: " << quant_inds.size() << std::endl;
+                        max_interp_level = std::min(interp_level, max_interp_level);
+                        set_stationary_range(interp_stationary_range, block, intra_block_dims, max_interp_level);
+                        recover_range(predictor.predecompress_block(intra_block_range), interp_stationary_range);
                     }
                     for (uint level = max_interp_level; level > 0 && level <= max_interp_level; level--) {
                         size_t stride_ip = 1U << (level - 1);
-                        block_interpolation(dec_data.get(), block.get_global_index(), interp_end_idx, PB_recover,
-                                            interpolators[interpolator_op], direction_op, stride_ip);
+                        block_interpolation<PB_recover>(dec_data, block_global_idx, interp_end_idx,
+                                                        stride_ip);
                     }
                 }
             }
 
-            assert(quant_index == num_elements);
-            predictor.postdecompress_data(inter_block_range->begin());
+            predictor.postdecompress_data(inter_block_range.begin());
 
-//            fallback_predictor.postdecompress_data(inter_block_range->begin());
+//            fallback_predictor.postdecompress_data(inter_block_range.begin());
             quantizer.postdecompress_data();
+        }
 
-            return dec_data.release();
+        // share of the blocks given to the predictor (0) and to interpolation (1)
+        void fill_selection(const std::vector<int> &block_selection) {
+            stats.selection.assign(2, 0);
+            for (auto &sel:block_selection) {
+                stats.selection[sel]++;
+            }
+            for (auto &share:stats.selection) {
+                share /= std::max<size_t>(block_selection.size(), 1);
+            }
         }
 
+        // print the statistics of the last call when asked to
+        void report() const {
+            if (verbose) {
+                stats.print();
+            }
+        }
 
+    public:
         // compress given the error bound
         uchar *compress(T *data, size_t &compressed_size) {
-            quant_inds.clear();
-            uchar *compressed_data = new uchar[2 * num_elements * sizeof(T)];
-            uchar *compressed_data_pos = compressed_data;
+            reset();
+            stats.clear();
+            stats.num_elements = num_elements;
+            stats.error_bound = quantizer.get_eb();
+            Timer timer(true);
             std::vector<int> block_selection;
-            data2 = std::vector<T>(data, data + num_elements);
+            std::vector<SZBlockInterpolationCompressor> workers;
 
 //            debug.resize(num_elements, 0);
 
-            auto inter_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions),
-                                                                                         block_size, 0);
-            auto intra_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions), 1, 0);
-            std::array<size_t, N> intra_block_dims;
-            predictor.precompress_data(inter_block_range->begin());
-            quantizer.precompress_data();
-            struct timespec start, end;
-            clock_gettime(CLOCK_REALTIME, &start);
-            {
-                auto inter_begin = inter_block_range->begin();
-                auto inter_end = inter_block_range->end();
-                for (auto block = inter_begin; block != inter_end; ++block) {
-
-                    auto block_global_idx = block.get_global_index();
-                    auto interp_end_idx = block.get_global_index();
-                    uint max_interp_level = 1;
-                    for (int i = 0; i < N; i++) {
-                        intra_block_dims[i] = (block_global_idx[i] + block_size > global_dimensions[i]) ?
-                                              global_dimensions[i] - block_global_idx[i] : block_size;
-                        interp_end_idx[i] += intra_block_dims[i] - 1;
-                        if (max_interp_level < ceil(log2(intra_block_dims[i]))) {
-                            max_interp_level = (uint) ceil(log2(intra_block_dims[i]));
-                        }
-                    }
-
-                    intra_block_range->set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
-                    intra_block_range->set_offsets(block.get_offset());
-                    intra_block_range->set_starting_position(block.get_local_index());
-                    concepts::PredictorInterface<T, N> *predictor_withfallback = &predictor;
-                    if (!predictor.precompress_block(intra_block_range)) {
-                        predictor_withfallback = &fallback_predictor;
-                    }
-                    double sz_predict_error = 1;
-//                    for (auto element = intra_block_range->begin(); element != intra_block_range->end(); ++element) {
-//                        sz_predict_error += predictor_withfallback->estimate_error(element);
-//                    }
-
-                    double interp_predict_error = 0;
-
-//                    for (uint level = max_interp_level; level > 0 && level <= max_interp_level; level--) {
-//                        uint stride_ip = 1U << (level - 1);
-//                        interp_predict_error += block_interpolation(data, block.get_global_index(), interp_end_idx, PB_predict,
-//                                                                    interpolators[interpolator_op], direction_op, stride_ip);
-//                    }
-
-                    if (sz_predict_error < interp_predict_error) {
-                        predictor_withfallback->precompress_block_commit();
-                        for (auto element = intra_block_range->begin(); element != intra_block_range->end(); ++element) {
-                            quant_inds.push_back(quantizer.quantize_and_overwrite(
-                                    *element, predictor_withfallback->predict(element)));
-                        }
-                        block_selection.push_back(0);
-                    } else {
-                        if (!interp_level) {
-                            auto first = intra_block_range->begin();
-                            quant_inds.push_back(quantizer.quantize_and_overwrite(*first, fallback_predictor.predict(first)));
-//                            debug[first.get_offset()]++;
-                        } else {
-                            max_interp_level = std::min(interp_level, max_interp_level);
-                            size_t stride_sz = 1U << max_interp_level;
-                            auto interp_stationary_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(
-                                    data, std::begin(global_dimensions), std::end(global_dimensions), stride_sz, 0);
-                            std::array<size_t, N> interp_stationary_dims;
-                            for (int i = 0; i < N; i++) {
-                                interp_stationary_dims[i] = ceil(1.0 * intra_block_dims[i] / stride_sz);
-//                                if (block_selection.size() == 11) {
-//                                   std::cout << "Dim " << interp_stationary_dims[i] << std::endl;
-//                                }
-                            }
-                            interp_stationary_range->set_dimensions(interp_stationary_dims.begin(), interp_stationary_dims.end());
-                            interp_stationary_range->set_offsets(block.get_offset());
-                            interp_stationary_range->set_starting_position(block.get_local_index());
-                            concepts::PredictorInterface<T, N> *interp_stationary_predictor = &predictor;
-                            if (!predictor.precompress_block(intra_block_range)) {
-                                interp_stationary_predictor = &fallback_predictor;
-                            }
-                            interp_stationary_predictor->precompress_block_commit();
-                            for (auto element = interp_stationary_range->begin();
-                                 element != interp_stationary_range->end(); ++element) {
-                                auto quan = quantizer.quantize_and_overwrite(
-                                        *element, interp_stationary_predictor->predict(element));
-                                quant_inds.push_back(quan);
-//                                debug[element.get_offset()]++;
-//                                if (block_selection.size() == 11) {
-//                                    std::cout << "Ele " << element.get_offset() << std::endl;
-//                                }
-                            }
-                        }
-                        for (uint level = max_interp_level; level > 0 && level <= max_interp_level; level--) {
-                            uint stride_ip = 1U << (level - 1);
-                            block_interpolation(data, block.get_global_index(), interp_end_idx, PB_predict_overwrite,
-                                                interpolators[interpolator_op], direction_op, stride_ip);
-                        }
-                        block_selection.push_back(1);
-                    }
+            init_interpolation_order();
+            batch_rows = batch_elements ?
+                         std::max<size_t>(1, (batch_elements + row_elements() - 1) / row_elements()) : 0;
+            if (!batch_rows) {
+                quant_inds.reserve(num_elements);
+                compress_blocks(data, 0, block_rows(), block_selection);
+                stats.unpredictable = quantizer.get_unpred().size();
+                quantizer.postcompress_data();
+            } else {
+                size_t rows = rows_per_batch();
+                size_t batches = num_batches();
+                std::vector<std::vector<int>> batch_selection(batches);
+                for (size_t b = 0; b < batches; b++) {
+                    workers.push_back(batch_worker());
+                }
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+                for (ptrdiff_t b = 0; b < (ptrdiff_t) batches; b++) {
+                    size_t first_row = b * rows;
+                    size_t end_row = std::min(first_row + rows, block_rows());
+                    workers[b].quant_inds.reserve(std::min(end_row * row_elements(), num_elements) -
+                                                  first_row * row_elements());
+                    workers[b].compress_blocks(data, first_row, end_row, batch_selection[b]);
+                    workers[b].stats.unpredictable = workers[b].quantizer.get_unpred().size();
+                    workers[b].quantizer.postcompress_data();
+                }
+                quant_inds.reserve(num_elements);
+                for (size_t b = 0; b < batches; b++) {
+                    quant_inds.insert(quant_inds.end(), workers[b].quant_inds.begin(), workers[b].quant_inds.end());
+                    std::vector<int>().swap(workers[b].quant_inds);
+                    block_selection.insert(block_selection.end(), batch_selection[b].begin(), batch_selection[b].end());
+                    stats.unpredictable += workers[b].stats.unpredictable;
                 }
             }
-//            for (size_t i = 0; i < num_elements; i++) {
-//                if (debug[i] != 1) {
-//                    std::cout << i << "," << debug[i] << std::endl;
-//                }
-//            }
-
             assert(quant_inds.size() == num_elements);
 
-            {
-                std::vector<size_t> cnt(2, 0);
-                size_t cnt_total = 0;
-                for (auto &sel:block_selection) {
-                    cnt[sel]++;
-                    cnt_total++;
-                }
-                printf("Interp Percentage = %.3f\nSZ Percentage = %.3f\n", 1.0 * cnt[1] / cnt_total, 1.0 * cnt[0] / cnt_total);
+            fill_selection(block_selection);
+            if (verbose) {
+                (workers.empty() ? predictor : workers[0].predictor).print();
             }
-            quantizer.postcompress_data();
-            predictor.print();
+            stats.add_time("Prediction & Quantization", timer.stop());
+            timer.start();
 
+            // the output grows in the arena as it is written, each writer reserves a bound of its own
+            size_t header_size = sizeof(T) + N * sizeof(size_t) + sizeof(block_size) + sizeof(uchar) +
+                                 sizeof(size_t);
+            if (workers.empty()) {
+                header_size += predictor.save_size_bound() + quantizer.save_size_bound();
+            } else {
+                header_size += (1 + workers.size()) * sizeof(size_t);
+                for (const auto &worker : workers) {
+                    header_size += worker.predictor.save_size_bound() + worker.quantizer.save_size_bound();
+                }
+            }
+            uchar *compressed_data_pos = arena.reserve(header_size);
             write(quantizer.get_eb(), compressed_data_pos);
             write(global_dimensions.data(), N, compressed_data_pos);
             write(block_size, compressed_data_pos);
-            predictor.save(compressed_data_pos);
-            quantizer.save(compressed_data_pos);
+            // whether the blocks are in batches, then the rows of blocks of a batch
+            write((uchar) (batch_rows != 0), compressed_data_pos);
+            if (batch_rows) {
+                write(batch_rows, compressed_data_pos);
+            }
+            if (workers.empty()) {
+                predictor.save(compressed_data_pos);
+                quantizer.save(compressed_data_pos);
+            } else {
+                // the predictor and unpredictable data of every batch, after the table of where each one ends
+                std::vector<size_t> ends(workers.size());
+                write(workers.size(), compressed_data_pos);
+                uchar *table_pos = compressed_data_pos;
+                compressed_data_pos += workers.size() * sizeof(size_t);
+                uchar const *sections_begin = compressed_data_pos;
+                for (size_t b = 0; b < workers.size(); b++) {
+                    workers[b].predictor.save(compressed_data_pos);
+                    workers[b].quantizer.save(compressed_data_pos);
+                    ends[b] = compressed_data_pos - sections_begin;
+                }
+                write(ends.data(), ends.size(), table_pos);
+                workers.clear();
+            }
+            arena.commit(compressed_data_pos);
 
             encoder.preprocess_encode(quant_inds, 4 * quantizer.get_radius());
+            compressed_data_pos = arena.reserve(encoder.save_size_bound() + encoder.encode_size_bound(num_elements));
             encoder.save(compressed_data_pos);
             encoder.encode(quant_inds, compressed_data_pos);
             encoder.postprocess_encode();
+            arena.commit(compressed_data_pos);
 
-            *reinterpret_cast<size_t *>(compressed_data_pos) = (size_t) block_selection.size();
-            compressed_data_pos += sizeof(size_t);
             HuffmanEncoder<int> selection_encoder;
             selection_encoder.preprocess_encode(block_selection, 4);
+            compressed_data_pos = arena.reserve(sizeof(size_t) + selection_encoder.save_size_bound() +
+                                                selection_encoder.encode_size_bound(block_selection.size()));
+            *reinterpret_cast<size_t *>(compressed_data_pos) = (size_t) block_selection.size();
+            compressed_data_pos += sizeof(size_t);
             selection_encoder.save(compressed_data_pos);
             selection_encoder.encode(block_selection, compressed_data_pos);
             selection_encoder.postprocess_encode();
+            arena.commit(compressed_data_pos);
+            stats.add_time("Encoding", timer.stop());
 
-            uchar *lossless_data = lossless.compress(compressed_data,
-                                                     compressed_data_pos - compressed_data,
-                                                     compressed_size);
-            lossless.postcompress_data(compressed_data);
+            timer.start();
+            uchar *lossless_data = lossless.compress(arena, compressed_size);
+            arena.rewind();
+            stats.add_time("Lossless", timer.stop());
+            stats.compressed_bytes = compressed_size;
+            report();
 
             return lossless_data;
         }
 
     private:
 
+        // compress the blocks of rows [first_row, end_row) along the first dimension, appending their indices
+        // to quant_inds and the choice of every block to block_selection
+        void compress_blocks(T *data, size_t first_row, size_t end_row, std::vector<int> &block_selection) {
+            auto inter_block_range = batch_range(data, first_row, end_row);
+            SZ::multi_dimensional_range<T, N> intra_block_range(data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), 1, 0);
+            SZ::multi_dimensional_range<T, N> interp_stationary_range(data, std::begin(global_dimensions),
+                                                                      std::end(global_dimensions), 1, 0);
+            std::array<size_t, N> intra_block_dims, interp_end_idx;
+            predictor.precompress_data(inter_block_range.begin());
+            quantizer.precompress_data();
+            auto inter_begin = inter_block_range.begin();
+            auto inter_end = inter_block_range.end();
+            for (auto block = inter_begin; block != inter_end; ++block) {
+
+                auto block_global_idx = block.get_global_index();
+                uint max_interp_level = block_extent(block_global_idx, intra_block_dims, interp_end_idx);
+
+                intra_block_range.set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
+                intra_block_range.set_offsets(block.get_offset());
+                intra_block_range.set_starting_position(block.get_local_index());
+                concepts::PredictorInterface<T, N> *predictor_withfallback = &predictor;
+                if (!predictor.precompress_block(intra_block_range)) {
+                    predictor_withfallback = &fallback_predictor;
+                }
+                double sz_predict_error = 0;
+                double interp_predict_error = 0;
+                estimate_block_errors(data, intra_block_range, predictor_withfallback, block_global_idx,
+                                      intra_block_dims, interp_level ? std::min(interp_level, max_interp_level)
+                                                                     : max_interp_level,
+                                      sz_predict_error, interp_predict_error);
+
+                if (sz_predict_error < interp_predict_error) {
+                    predictor_withfallback->precompress_block_commit();
+                    quantize_range(predictor_withfallback == &predictor, intra_block_range);
+                    block_selection.push_back(0);
+                } else {
+                    if (!interp_level) {
+                        auto first = intra_block_range.begin();
+                        quant_inds.push_back(quantizer.quantize_and_overwrite(*first, fallback_predictor.predict(first)));
+//                            debug[first.get_offset()]++;
+                    } else {
+                        max_interp_level = std::min(interp_level, max_interp_level);
+                        set_stationary_range(interp_stationary_range, block, intra_block_dims, max_interp_level);
+                        concepts::PredictorInterface<T, N> *interp_stationary_predictor = &predictor;
+                        if (!predictor.precompress_block(intra_block_range)) {
+                            interp_stationary_predictor = &fallback_predictor;
+                        }
+                        interp_stationary_predictor->precompress_block_commit();
+                        quantize_range(interp_stationary_predictor == &predictor, interp_stationary_range);
+                    }
+                    for (uint level = max_interp_level; level > 0 && level <= max_interp_level; level--) {
+                        uint stride_ip = 1U << (level - 1);
+                        block_interpolation<PB_predict_overwrite>(data, block_global_idx, interp_end_idx,
+                                                                  stride_ip);
+                    }
+                    block_selection.push_back(1);
+                }
+            }
+        }
+
+        // points of a block per sample of the predictor selection
+        static const size_t selection_ratio = 64;
+        // bits per sample interpolation may lose before a block switches to the predictor
+        static constexpr double interp_margin = 0.5;
+
         enum PredictorBehavior {
             PB_predict_overwrite, PB_predict, PB_recover
         };
@@ -364,217 +660,324 @@ namespace SZ {
         }
 
         inline void recover(T &d, T pred) {
-            d = quantizer.recover(pred, quant_inds[quant_index++]);
+            d = quantizer.recover(pred, dec_inds[quant_index++]);
         };
 
 
-        double block_interpolation_1d(T *data, size_t begin, size_t end, size_t stride,
-                                      const std::string &interp_func,
-                                      const PredictorBehavior pb) {
-            size_t n = (end - begin) / stride + 1;
-            if (n <= 1) {
-                return 0;
+        template<PredictorBehavior pb>
+        inline void predict(T &d, T pred) {
+            if (pb == PB_predict_overwrite) {
+                quantize(d, pred);
+            } else {
+                recover(d, pred);
             }
-            double predict_error = 0;
+        }
 
-            size_t stride3x = 3 * stride;
-            size_t stride5x = 5 * stride;
-            if (interp_func == "linear" || n < 5) {
-                if (pb == PB_predict_overwrite) {
-                    for (size_t i = 1; i + 1 < n; i += 2) {
-                        T *d = data + begin + i * stride;
-                        quantize(*d, interp_linear(*(d - stride), *(d + stride)));
-                    }
-                    if (n % 2 == 0) {
-                        T *d = data + begin + (n - 1) * stride;
-                        if (n < 4) {
-                            quantize(*d, *(d - stride));
-                        } else {
-                            quantize(*d, interp_linear1(*(d - stride3x), *(d - stride)));
-                        }
-                    }
-                } else {
-                    for (size_t i = 1; i + 1 < n; i += 2) {
-                        T *d = data + begin + i * stride;
-                        recover(*d, interp_linear(*(d - stride), *(d + stride)));
+        // global strides and the order in which block_interpolation goes through the dimensions at every level
+        void init_interpolation_order() {
+            dimension_offsets[N - 1] = 1;
+            for (int i = N - 2; i >= 0; i--) {
+                dimension_offsets[i] = dimension_offsets[i + 1] * global_dimensions[i + 1];
+            }
+            for (uint i = 0; i < N; i++) {
+                direction_sequence[i] = i;
+            }
+            if constexpr (N == 2) {
+                if (direction_op != 0) {
+                    std::swap(direction_sequence[0], direction_sequence[1]);
+                }
+            } else if constexpr (N == 3) {
+                static const uint sequences[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+                for (uint i = 0; i < N; i++) {
+                    direction_sequence[i] = sequences[direction_op % 6][i];
+                }
+            }
+        }
+
+        // prediction of point i of a line of n points at the given stride, as block_interpolation_1d makes it
+        T interpolate_in_line(const T *d, size_t i, size_t n, size_t stride) const {
+            if (interpolator_op == INTERP_ALGO_LINEAR || n < 5) {
+                if (i + 1 < n) {
+                    return interp_linear(*(d - stride), *(d + stride));
+                }
+                return n < 4 ? *(d - stride) : interp_linear1(*(d - 3 * stride), *(d - stride));
+            }
+            if (i == 1) {
+                return interp_quad_1(*(d - stride), *(d + stride), *(d + 3 * stride));
+            }
+            if (i + 3 < n) {
+                switch (interpolator_op) {
+                    case INTERP_ALGO_AKIMA:
+                        return interp_cubic_family<INTERP_ALGO_AKIMA>(*(d - 3 * stride), *(d - stride),
+                                                                      *(d + stride), *(d + 3 * stride));
+                    case INTERP_ALGO_PCHIP:
+                        return interp_cubic_family<INTERP_ALGO_PCHIP>(*(d - 3 * stride), *(d - stride),
+                                                                      *(d + stride), *(d + 3 * stride));
+                    default:
+                        return interp_cubic(*(d - 3 * stride), *(d - stride), *(d + stride), *(d + 3 * stride));
+                }
+            }
+            if (i + 1 < n) {
+                return interp_quad_2(*(d - 3 * stride), *(d - stride), *(d + stride));
+            }
+            return interp_quad_3(*(d - 5 * stride), *(d - 3 * stride), *(d - stride));
+        }
+
+        // Bits the block predictor and interpolation would spend on about one point in 64 of the block, as
+        // log2(1 + error / eb), with a margin in favor of interpolation
+        void estimate_block_errors(const T *data, multi_dimensional_range<T, N> &range,
+                                   concepts::PredictorInterface<T, N> *block_predictor,
+                                   const std::array<size_t, N> &block_idx, const std::array<size_t, N> &block_dims,
+                                   uint levels, double &sz_error, double &interp_error) const {
+            const double eb = quantizer.get_eb();
+            const double interp_noise = 0.5 * eb;
+            size_t block_num = 1;
+            size_t block_offset = 0;
+            for (uint i = 0; i < N; i++) {
+                block_num *= block_dims[i];
+                block_offset += block_idx[i] * dimension_offsets[i];
+            }
+            // fewer samples make the choice noisy, more would cost too much in small blocks
+            size_t samples = std::max<size_t>(block_num / selection_ratio, std::min<size_t>(16, block_num / 32 + 1));
+            uint64_t state = block_offset;
+            auto begin = range.begin();
+            for (size_t sample = 0; sample < samples; sample++) {
+                std::array<size_t, N> local;
+                std::array<int, N> move;
+                size_t offset = block_offset;
+                uint level_shift = 63;
+                for (uint i = 0; i < N; i++) {
+                    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                    local[i] = block_dims[i] > 1 ? 1 + (((state >> 32) * (block_dims[i] - 1)) >> 32) : 0;
+                    move[i] = (int) local[i];
+                    offset += local[i] * dimension_offsets[i];
+                    if (local[i]) {
+                        level_shift = std::min<uint>(level_shift, __builtin_ctzll(local[i]));
                     }
-                    if (n % 2 == 0) {
-                        T *d = data + begin + (n - 1) * stride;
-                        if (n < 4) {
-                            recover(*d, *(d - stride));
-                        } else {
-                            recover(*d, interp_linear1(*(d - stride3x), *(d - stride)));
+                }
+                auto element = begin;
+                element.move2(move);
+                double error = block_predictor->estimate_error(element);
+                sz_error += log2(1 + error / eb);
+                if (level_shift < levels) {
+                    uint dim = N;
+                    for (uint i = 0; i < N; i++) {
+                        if ((local[direction_sequence[i]] >> level_shift) & 1) {
+                            dim = direction_sequence[i];
                         }
                     }
+                    size_t stride = (size_t) 1 << level_shift;
+                    const T *d = data + offset;
+                    error = fabs(*d - interpolate_in_line(d, local[dim] >> level_shift,
+                                                          (block_dims[dim] - 1) / stride + 1,
+                                                          stride * dimension_offsets[dim])) + interp_noise;
                 }
-            } else {
-                if (pb == PB_predict_overwrite) {
+                interp_error += log2(1 + error / eb) - interp_margin;
+            }
+        }
 
-                    T *d = data + begin + stride;
-                    quantize(*d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
+        // the interpolator is selected once per block and level, so the line kernels carry no runtime dispatch
+        template<PredictorBehavior pb>
+        double block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, uint stride_ip) {
+            switch (interpolator_op) {
+                case INTERP_ALGO_LINEAR:
+                    return block_interpolation<INTERP_ALGO_LINEAR, pb>(data, begin, end, direction_op, stride_ip);
+                case INTERP_ALGO_AKIMA:
+                    return block_interpolation<INTERP_ALGO_AKIMA, pb>(data, begin, end, direction_op, stride_ip);
+                case INTERP_ALGO_PCHIP:
+                    return block_interpolation<INTERP_ALGO_PCHIP, pb>(data, begin, end, direction_op, stride_ip);
+                default:
+                    return block_interpolation<INTERP_ALGO_CUBIC, pb>(data, begin, end, direction_op, stride_ip);
+            }
+        }
 
-                    for (size_t i = 3; i + 3 < n; i += 2) {
-                        d = data + begin + i * stride;
-                        quantize(*d, interp_cubic(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x)));
-                    }
-                    if (n % 2 == 0) {
-                        d = data + begin + (n - 3) * stride;
-                        quantize(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
-                        d += 2 * stride;
-                        quantize(*d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
-                    } else {
-                        d = data + begin + (n - 2) * stride;
-                        quantize(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
-                    }
+        // vector kernels for the interior points of contiguous lines, returns the first point left to the scalar loop
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        inline size_t contiguous_interpolation(T *line, size_t i, size_t n) {
+            if constexpr (simd_vector<T>::width > 1 && std::is_same<Quantizer, LinearQuantizer<T>>::value &&
+                          (algo == INTERP_ALGO_LINEAR || algo == INTERP_ALGO_CUBIC)) {
+                size_t first = i;
+                if (pb == PB_predict_overwrite) {
+                    size_t quant_pos = quant_inds.size();
+                    quant_inds.resize(quant_pos + (n - i) / 2);
+                    i = simd_interp_quantize<T, algo>(line, i, n, nullptr, quantizer.get_eb(), quantizer.get_radius(),
+                                                      quant_inds.data() + quant_pos,
+                                                      [&](size_t, T ori) { quantizer.insert_unpred(ori); });
+                    quant_inds.resize(quant_pos + (i - first) / 2);
                 } else {
-                    T *d = data + begin + stride;
-                    recover(*d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
+                    i = simd_interp_recover<T, algo>(line, i, n, nullptr, quantizer.get_eb(), quantizer.get_radius(),
+                                                     dec_inds + quant_index,
+                                                     [&]() { return quantizer.recover_unpred(); });
+                    quant_index += (i - first) / 2;
+                }
+            }
+            return i;
+        }
 
-                    for (size_t i = 3; i + 3 < n; i += 2) {
-                        d = data + begin + i * stride;
-                        recover(*d, interp_cubic(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x)));
-                    }
-                    if (n % 2 == 0) {
-                        d = data + begin + (n - 3) * stride;
-                        recover(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
-                        d += 2 * stride;
-                        recover(*d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        double block_interpolation_1d(T *data, size_t begin, size_t end, size_t stride) {
+            size_t n = (end - begin) / stride + 1;
+            if (n <= 1) {
+                return 0;
+            }
+            double predict_error = 0;
+
+            size_t stride3x = 3 * stride;
+            size_t stride5x = 5 * stride;
+            if (algo == INTERP_ALGO_LINEAR || n < 5) {
+                size_t i = 1;
+                if (algo == INTERP_ALGO_LINEAR && stride == 1) {
+                    i = contiguous_interpolation<algo, pb>(data + begin, i, n);
+                }
+                for (; i + 1 < n; i += 2) {
+                    T *d = data + begin + i * stride;
+                    predict<pb>(*d, interp_linear(*(d - stride), *(d + stride)));
+                }
+                if (n % 2 == 0) {
+                    T *d = data + begin + (n - 1) * stride;
+                    if (n < 4) {
+                        predict<pb>(*d, *(d - stride));
                     } else {
-                        d = data + begin + (n - 2) * stride;
-                        recover(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
+                        predict<pb>(*d, interp_linear1(*(d - stride3x), *(d - stride)));
                     }
+                }
+            } else {
+                T *d = data + begin + stride;
+                predict<pb>(*d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
 
+                size_t i = 3;
+                if (stride == 1) {
+                    i = contiguous_interpolation<algo, pb>(data + begin, i, n);
+                }
+                for (; i + 3 < n; i += 2) {
+                    d = data + begin + i * stride;
+                    predict<pb>(*d, interp_cubic_family<algo>(*(d - stride3x), *(d - stride), *(d + stride),
+                                                              *(d + stride3x)));
+                }
+                if (n % 2 == 0) {
+                    d = data + begin + (n - 3) * stride;
+                    predict<pb>(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
+                    d += 2 * stride;
+                    predict<pb>(*d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
+                } else {
+                    d = data + begin + (n - 2) * stride;
+                    predict<pb>(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
                 }
             }
             return predict_error;
         }
 
-        template<uint NN = N>
+        template<INTERP_ALGO algo, PredictorBehavior pb, uint NN = N>
         typename std::enable_if<NN == 1, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride_ip = 1) {
-            return block_interpolation_1d(data, offset2(begin), offset2(end), 1, interp_func, pb);
+        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end,
+                            const int direction, uint stride_ip = 1) {
+            return block_interpolation_1d<algo, pb>(data, offset2(begin), offset2(end), stride_ip);
         }
 
-        template<uint NN = N>
+        template<INTERP_ALGO algo, PredictorBehavior pb, uint NN = N>
         typename std::enable_if<NN == 2, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride_ip = 1) {
+        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end,
+                            const int direction, uint stride_ip = 1) {
             double predict_error = 0;
             size_t stride_ip2 = stride_ip * 2;
             if (direction == 0) {
                 for (size_t j = begin[1]; j <= end[1]; j += stride_ip2) {
-                    predict_error += block_interpolation_1d(data, offset(begin[0], j), offset(end[0], j),
-                                                            stride_ip * global_dimensions[1],
-                                                            interp_func, pb);
+                    predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], j), offset(end[0], j),
+                                                                      stride_ip * global_dimensions[1]);
                 }
                 for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
-                    predict_error += block_interpolation_1d(data, offset(i, begin[1]), offset(i, end[1]), stride_ip, interp_func,
-                                                            pb);
+                    predict_error += block_interpolation_1d<algo, pb>(data, offset(i, begin[1]), offset(i, end[1]), stride_ip);
                 }
             } else {
                 for (size_t i = begin[0]; i <= end[0]; i += stride_ip2) {
-                    predict_error += block_interpolation_1d(data, offset(i, begin[1]), offset(i, end[1]), stride_ip, interp_func,
-                                                            pb);
+                    predict_error += block_interpolation_1d<algo, pb>(data, offset(i, begin[1]), offset(i, end[1]), stride_ip);
                 }
                 for (size_t j = begin[1]; j <= end[1]; j += stride_ip) {
-                    predict_error += block_interpolation_1d(data, offset(begin[0], j), offset(end[0], j),
-                                                            stride_ip * global_dimensions[1],
-                                                            interp_func, pb);
+                    predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], j), offset(end[0], j),
+                                                                      stride_ip * global_dimensions[1]);
                 }
             }
             return predict_error;
         }
 
-        template<uint NN = N>
+        template<INTERP_ALGO algo, PredictorBehavior pb, uint NN = N>
         typename std::enable_if<NN == 4, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride_ip = 1) {
+        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end,
+                            const int direction, uint stride_ip = 1) {
             double predict_error = 0;
             size_t stride_ip2 = stride_ip * 2;
             for (size_t j = begin[1]; j <= end[1]; j += stride_ip2) {
                 for (size_t k = begin[2]; k <= end[2]; k += stride_ip2) {
                     for (size_t t = (begin[3] ? begin[3] + stride_ip2 : 0); t <= end[3]; t += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(begin[0], j, k, t), offset(end[0], j, k, t),
-                                                                stride_ip * global_dimensions[1] * global_dimensions[2] *
-                                                                global_dimensions[3],
-                                                                interp_func, pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], j, k, t), offset(end[0], j, k, t),
+                                                                          stride_ip * global_dimensions[1] * global_dimensions[2] *
+                                                                          global_dimensions[3]);
                     }
                 }
             }
             for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                 for (size_t k = begin[2]; k <= end[2]; k += stride_ip2) {
                     for (size_t t = (begin[3] ? begin[3] + stride_ip2 : 0); t <= end[3]; t += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(i, begin[1], k, t), offset(i, end[1], k, t),
-                                                                stride_ip * global_dimensions[2] * global_dimensions[3],
-                                                                interp_func, pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(i, begin[1], k, t), offset(i, end[1], k, t),
+                                                                          stride_ip * global_dimensions[2] * global_dimensions[3]);
                     }
                 }
             }
             for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                 for (size_t j = begin[1]; j <= end[1]; j += stride_ip) {
                     for (size_t t = (begin[3] ? begin[3] + stride_ip2 : 0); t <= end[3]; t += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(i, j, begin[2], t), offset(i, j, end[2], t),
-                                                                stride_ip * global_dimensions[3],
-                                                                interp_func, pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(i, j, begin[2], t), offset(i, j, end[2], t),
+                                                                          stride_ip * global_dimensions[3]);
                     }
                 }
             }
             for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                 for (size_t j = begin[1]; j <= end[1]; j += stride_ip) {
                     for (size_t k = begin[2]; k <= end[2]; k += stride_ip) {
-                        predict_error += block_interpolation_1d(data, offset(i, j, k, begin[3]), offset(i, j, k, end[3]),
-                                                                stride_ip, interp_func, pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(i, j, k, begin[3]), offset(i, j, k, end[3]),
+                                                                          stride_ip);
                     }
                 }
             }
             return predict_error;
         }
 
-        template<uint NN = N>
+        template<INTERP_ALGO algo, PredictorBehavior pb, uint NN = N>
         typename std::enable_if<NN == 3, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride_ip = 1) {
+        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end,
+                            const int direction, uint stride_ip = 1) {
             double predict_error = 0;
             size_t stride_ip2 = stride_ip * 2;
 
             if (direction == 0 || direction == 1) {
                 for (size_t j = begin[1]; j <= end[1]; j += stride_ip2) {
                     for (size_t k = begin[2]; k <= end[2]; k += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(begin[0], j, k), offset(end[0], j, k),
-                                                                stride_ip * global_dimensions[1] * global_dimensions[2],
-                                                                interp_func,
-                                                                pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], j, k), offset(end[0], j, k),
+                                                                          stride_ip * global_dimensions[1] * global_dimensions[2]);
                     }
                 }
                 if (direction == 0) {
                     for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                         for (size_t k = begin[2]; k <= end[2]; k += stride_ip2) {
-                            predict_error += block_interpolation_1d(data, offset(i, begin[1], k), offset(i, end[1], k),
-                                                                    stride_ip * global_dimensions[2],
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(i, begin[1], k), offset(i, end[1], k),
+                                                                              stride_ip * global_dimensions[2]);
                         }
                     }
                     for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                         for (size_t j = begin[1]; j <= end[1]; j += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(i, j, begin[2]), offset(i, j, end[2]), stride_ip,
-                                                                    interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(i, j, begin[2]), offset(i, j, end[2]), stride_ip);
                         }
                     }
                 } else {
                     for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                         for (size_t j = begin[1]; j <= end[1]; j += stride_ip2) {
-                            predict_error += block_interpolation_1d(data, offset(i, j, begin[2]), offset(i, j, end[2]), stride_ip,
-                                                                    interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(i, j, begin[2]), offset(i, j, end[2]), stride_ip);
                         }
                     }
                     for (size_t i = begin[0]; i <= end[0]; i += stride_ip) {
                         for (size_t k = begin[2]; k <= end[2]; k += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(i, begin[1], k), offset(i, end[1], k),
-                                                                    stride_ip * global_dimensions[2],
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(i, begin[1], k), offset(i, end[1], k),
+                                                                              stride_ip * global_dimensions[2]);
                         }
                     }
                 }
@@ -582,42 +985,34 @@ namespace SZ {
             } else if (direction == 2 || direction == 3) {
                 for (size_t k = begin[0]; k <= end[0]; k += stride_ip2) {
                     for (size_t j = begin[2]; j <= end[2]; j += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(k, begin[1], j), offset(k, end[1], j),
-                                                                stride_ip * global_dimensions[2],
-                                                                interp_func,
-                                                                pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(k, begin[1], j), offset(k, end[1], j),
+                                                                          stride_ip * global_dimensions[2]);
                     }
                 }
                 if (direction == 2) {
                     for (size_t i = begin[1]; i <= end[1]; i += stride_ip) {
                         for (size_t j = begin[2]; j <= end[2]; j += stride_ip2) {
-                            predict_error += block_interpolation_1d(data, offset(begin[0], i, j), offset(end[0], i, j),
-                                                                    stride_ip * global_dimensions[1] * global_dimensions[2],
-                                                                    interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], i, j), offset(end[0], i, j),
+                                                                              stride_ip * global_dimensions[1] * global_dimensions[2]);
                         }
                     }
                     for (size_t k = begin[0]; k <= end[0]; k += stride_ip) {
                         for (size_t i = begin[1]; i <= end[1]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(k, i, begin[2]), offset(k, i, end[2]),
-                                                                    stride_ip,
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(k, i, begin[2]), offset(k, i, end[2]),
+                                                                              stride_ip);
                         }
                     }
                 } else {
                     for (size_t k = begin[0]; k <= end[0]; k += stride_ip2) {
                         for (size_t i = begin[1]; i <= end[1]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(k, i, begin[2]), offset(k, i, end[2]),
-                                                                    stride_ip,
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(k, i, begin[2]), offset(k, i, end[2]),
+                                                                              stride_ip);
                         }
                     }
                     for (size_t i = begin[1]; i <= end[1]; i += stride_ip) {
                         for (size_t j = begin[2]; j <= end[2]; j += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(begin[0], i, j), offset(end[0], i, j),
-                                                                    stride_ip * global_dimensions[1] * global_dimensions[2],
-                                                                    interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], i, j), offset(end[0], i, j),
+                                                                              stride_ip * global_dimensions[1] * global_dimensions[2]);
                         }
                     }
                 }
@@ -626,38 +1021,34 @@ namespace SZ {
 
                 for (size_t j = begin[0]; j <= end[0]; j += stride_ip2) {
                     for (size_t k = begin[1]; k <= end[1]; k += stride_ip2) {
-                        predict_error += block_interpolation_1d(data, offset(j, k, begin[2]), offset(j, k, end[2]),
-                                                                stride_ip, interp_func, pb);
+                        predict_error += block_interpolation_1d<algo, pb>(data, offset(j, k, begin[2]), offset(j, k, end[2]),
+                                                                          stride_ip);
                     }
                 }
                 if (direction == 4) {
                     for (size_t k = begin[1]; k <= end[1]; k += stride_ip2) {
                         for (size_t i = begin[2]; i <= end[2]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(begin[0], k, i), offset(end[0], k, i),
-                                                                    stride_ip * global_dimensions[1] * global_dimensions[2],
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], k, i), offset(end[0], k, i),
+                                                                              stride_ip * global_dimensions[1] * global_dimensions[2]);
                         }
                     }
                     for (size_t j = begin[0]; j <= end[0]; j += stride_ip) {
                         for (size_t i = begin[2]; i <= end[2]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(j, begin[1], i), offset(j, end[1], i),
-                                                                    stride_ip * global_dimensions[2], interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(j, begin[1], i), offset(j, end[1], i),
+                                                                              stride_ip * global_dimensions[2]);
                         }
                     }
                 } else {
                     for (size_t j = begin[0]; j <= end[0]; j += stride_ip2) {
                         for (size_t i = begin[2]; i <= end[2]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(j, begin[1], i), offset(j, end[1], i),
-                                                                    stride_ip * global_dimensions[2], interp_func,
-                                                                    pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(j, begin[1], i), offset(j, end[1], i),
+                                                                              stride_ip * global_dimensions[2]);
                         }
                     }
                     for (size_t k = begin[1]; k <= end[1]; k += stride_ip) {
                         for (size_t i = begin[2]; i <= end[2]; i += stride_ip) {
-                            predict_error += block_interpolation_1d(data, offset(begin[0], k, i), offset(end[0], k, i),
-                                                                    stride_ip * global_dimensions[1] * global_dimensions[2],
-                                                                    interp_func, pb);
+                            predict_error += block_interpolation_1d<algo, pb>(data, offset(begin[0], k, i), offset(end[0], k, i),
+                                                                              stride_ip * global_dimensions[1] * global_dimensions[2]);
                         }
                     }
                 }
@@ -669,21 +1060,32 @@ namespace SZ {
         int direction_op;
         double sz_eb_ratio = 1;
         uint interp_level;
-        std::vector<std::string> interpolators;
         std::vector<int> quant_inds;
         std::vector<int> block_select_quant;
         size_t quant_index = 0; // for decompress
+        const int *dec_inds = nullptr; // the indices of the blocks being decompressed
+        std::vector<size_t> section_ends; // for decompress, where the data of every batch ends after sections
+        uchar const *sections = nullptr;
+        std::vector<int> selected_blocks; // for decompress, the predictor of every block
 //        std::vector<int> debug;
-        std::vector<T> data2;
         Predictor predictor;
         LorenzoPredictor<T, N, 1> fallback_predictor;
         Quantizer quantizer;
         Encoder encoder;
         Lossless lossless;
+        Workspace workspace;
+        OutputArena arena;
+        CompressionStats stats;
+        bool verbose = false;
         uint block_size;
         uint stride;
         size_t num_elements;
         std::array<size_t, N> global_dimensions;
+        std::array<size_t, N> dimension_offsets;
+        std::array<uint, N> direction_sequence; // dimensions in the order of block_interpolation, compression only
+        size_t batch_elements = 0;
+        size_t batch_rows = 0; // see rows_per_batch()
+        int num_threads = 1;
     };
 
     template<class T, uint N, class Predictor, class Quantizer, class Encoder, class Lossless>
@@ -0,0 +1,282 @@
+#ifndef _SZ_SZ_CHUNKED_INTERPOLATION_HPP
+#define _SZ_SZ_CHUNKED_INTERPOLATION_HPP
+
+#include "compressor/SZInterpolationCompressor.hpp"
+#include "utils/MemoryUtil.hpp"
+#include "utils/Timer.hpp"
+#include "utils/CompressionStats.hpp"
+#include "def.hpp"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace SZ {
+    // Cuts the grid into tiles of chunk_size^N points, each compressed by its own SZInterpolationCompressor
+    // with its own anchor, quantization indices and unpredictable data.
+    // An offset table in the header allows tiles to be decompressed independently and in parallel.
+    template<class T, uint N, class Quantizer, class Encoder, class Lossless>
+    class SZChunkedInterpolationCompressor {
+    public:
+
+        SZChunkedInterpolationCompressor(Quantizer quantizer, Encoder encoder, Lossless lossless,
+                                         const std::array<size_t, N> dims,
+                                         size_t chunk_size,
+                                         size_t blocksize,
+                                         int interpolator,
+                                         int direction,
+                                         int interp_levels) :
+                quantizer(quantizer), encoder(encoder), lossless(lossless),
+                global_dimensions(dims), chunk_size(chunk_size), blocksize(blocksize),
+                interpolator_id(interpolator), direction_sequence_id(direction), interp_levels(interp_levels) {
+            assert(chunk_size > 1 && "Chunk size should be larger than 1");
+            init();
+        }
+
+        // number of threads working on different tiles, the output does not depend on it
+        void set_num_threads(int threads) {
+            num_threads = threads > 0 ? threads : 1;
+        }
+
+        int get_num_threads() const {
+            return num_threads;
+        }
+
+        // what the last compression or decompression of the whole grid measured
+        const CompressionStats &get_stats() const {
+            return stats;
+        }
+
+        // print the statistics at the end of every call, nothing is printed otherwise
+        void set_verbose(bool print) {
+            verbose = print;
+        }
+
+        bool get_verbose() const {
+            return verbose;
+        }
+
+        // compress given the error bound, the input data is left unchanged
+        uchar *compress(T *data, size_t &compressed_size) {
+            stats.clear();
+            stats.num_elements = num_elements;
+            Timer timer(true);
+            std::vector<std::unique_ptr<uchar[]>> chunk_data(num_chunks);
+            std::vector<size_t> chunk_offsets(num_chunks + 1, 0);
+            init_workers();
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+            for (ptrdiff_t c = 0; c < (ptrdiff_t) num_chunks; c++) {
+                std::array<size_t, N> origin, dims;
+                size_t num = chunk_range(c, origin, dims);
+                auto &chunk = tile_buffers[thread_id()];
+                chunk.resize(num);
+                copy_chunk(data, chunk.data(), origin, dims, true);
+
+                size_t size = 0;
+                chunk_data[c].reset(chunk_compressor(dims).compress(chunk.data(), size));
+                chunk_offsets[c + 1] = size;
+            }
+            for (size_t c = 0; c < num_chunks; c++) {
+                chunk_offsets[c + 1] += chunk_offsets[c];
+            }
+            stats.add_time("Chunked Interpolation Compress", timer.stop());
+
+            // dimensions, chunk size, chunk count and offsets
+            size_t header_size = sizeof(size_t) * (N + 2 + num_chunks + 1);
+            compressed_size = header_size + chunk_offsets[num_chunks];
+            uchar *compressed_data = new uchar[compressed_size];
+            uchar *compressed_data_pos = compressed_data;
+            write(global_dimensions.data(), N, compressed_data_pos);
+            write(chunk_size, compressed_data_pos);
+            write(num_chunks, compressed_data_pos);
+            write(chunk_offsets.data(), num_chunks + 1, compressed_data_pos);
+            for (size_t c = 0; c < num_chunks; c++) {
+                write(chunk_data[c].get(), chunk_offsets[c + 1] - chunk_offsets[c], compressed_data_pos);
+            }
+            assert((size_t) (compressed_data_pos - compressed_data) == compressed_size);
+            stats.compressed_bytes = compressed_size;
+            report();
+            return compressed_data;
+        }
+
+        T *decompress(uchar const *compressed_data, const size_t length) {
+            size_t remaining_length = length;
+            uchar const *compressed_data_pos = compressed_data;
+            stats.clear();
+            stats.compressed_bytes = length;
+            if (length < sizeof(size_t) * (N + 2)) {
+                throw std::runtime_error("chunked stream of " + std::to_string(length) + " bytes has no header");
+            }
+            read(global_dimensions.data(), N, compressed_data_pos, remaining_length);
+            read(chunk_size, compressed_data_pos, remaining_length);
+            for (const auto &d : global_dimensions) {
+                if (d == 0 || chunk_size < 2) {
+                    throw std::runtime_error("chunked stream has an empty dimension or a chunk size below 2");
+                }
+            }
+            init();
+            size_t chunks = 0;
+            read(chunks, compressed_data_pos, remaining_length);
+            if (chunks != num_chunks) {
+                throw std::runtime_error("chunked stream has " + std::to_string(chunks) + " chunks for " +
+                                         std::to_string(num_chunks));
+            }
+            if (remaining_length / sizeof(size_t) < num_chunks + 1) {
+                throw std::runtime_error("chunked stream ends in its offset table");
+            }
+            std::vector<size_t> chunk_offsets(num_chunks + 1);
+            read(chunk_offsets.data(), num_chunks + 1, compressed_data_pos, remaining_length);
+            for (size_t c = 0; c < num_chunks; c++) {
+                if (chunk_offsets[c] > chunk_offsets[c + 1]) {
+                    throw std::runtime_error("chunked stream has a decreasing offset table");
+                }
+            }
+            if (chunk_offsets[0] != 0 || chunk_offsets[num_chunks] > remaining_length) {
+                throw std::runtime_error("chunked stream has " + std::to_string(remaining_length) +
+                                         " bytes of chunks for " + std::to_string(chunk_offsets[num_chunks]));
+            }
+
+            Timer timer(true);
+            T *dec_data = new T[num_elements];
+            init_workers();
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+            for (ptrdiff_t c = 0; c < (ptrdiff_t) num_chunks; c++) {
+                std::array<size_t, N> origin, dims;
+                size_t num = chunk_range(c, origin, dims);
+                auto &chunk = tile_buffers[thread_id()];
+                chunk.resize(num);
+                chunk_compressor(dims).decompress(compressed_data_pos + chunk_offsets[c],
+                                                  chunk_offsets[c + 1] - chunk_offsets[c], chunk.data());
+                copy_chunk(dec_data, chunk.data(), origin, dims, false);
+            }
+            stats.add_time("Chunked Interpolation Decompress", timer.stop());
+            stats.num_elements = num_elements;
+            report();
+            return dec_data;
+        }
+
+    private:
+        // print the statistics of the last call when asked to
+        void report() const {
+            if (verbose) {
+                stats.print();
+            }
+        }
+
+
+        void init() {
+            num_elements = 1;
+            num_chunks = 1;
+            for (int i = 0; i < N; i++) {
+                num_elements *= global_dimensions[i];
+                chunk_counts[i] = (global_dimensions[i] - 1) / chunk_size + 1;
+                num_chunks *= chunk_counts[i];
+            }
+            dimension_offsets[N - 1] = 1;
+            for (int i = N - 2; i >= 0; i--) {
+                dimension_offsets[i] = dimension_offsets[i + 1] * global_dimensions[i + 1];
+            }
+        }
+
+        using TileCompressor = SZInterpolationCompressor<T, N, Quantizer, Encoder, Lossless>;
+
+        static int thread_id() {
+#ifdef _OPENMP
+            return omp_get_thread_num();
+#else
+            return 0;
+#endif
+        }
+
+        // a compressor and a tile buffer for every thread, kept from one call to the next
+        void init_workers() {
+            workers.resize((size_t) num_threads << N);
+            worker_dims.resize(workers.size());
+            tile_buffers.resize(num_threads);
+        }
+
+        // the compressor of the calling thread for tiles of the given dimensions; only the tiles on the upper faces
+        // of the grid are smaller, so a thread needs one for each of at most 2^N shapes. Its coder tree, lossless
+        // contexts and workspace serve every tile of that shape
+        TileCompressor &chunk_compressor(const std::array<size_t, N> &dims) {
+            size_t shape = 0;
+            for (int i = 0; i < N; i++) {
+                shape = shape << 1 | (dims[i] != chunk_size);
+            }
+            size_t w = ((size_t) thread_id() << N) + shape;
+            auto &worker = workers[w];
+            if (!worker || worker_dims[w] != dims) {
+                worker_dims[w] = dims;
+                worker.reset(new TileCompressor(quantizer, encoder, lossless, dims, blocksize, interpolator_id,
+                                                direction_sequence_id, interp_levels));
+            }
+            return *worker;
+        }
+
+        // origin and dimensions of a tile given its row-major index, returns its number of points
+        size_t chunk_range(size_t chunk, std::array<size_t, N> &origin, std::array<size_t, N> &dims) const {
+            size_t num = 1;
+            for (int i = N - 1; i >= 0; i--) {
+                origin[i] = chunk % chunk_counts[i] * chunk_size;
+                dims[i] = std::min(chunk_size, global_dimensions[i] - origin[i]);
+                num *= dims[i];
+                chunk /= chunk_counts[i];
+            }
+            return num;
+        }
+
+        // copy a tile from the global array into its own buffer (gather) or back (scatter)
+        void copy_chunk(T *global_data, T *chunk_data, const std::array<size_t, N> &origin,
+                        const std::array<size_t, N> &dims, bool gather) const {
+            size_t row = dims[N - 1];
+            size_t rows = 1;
+            for (int i = 0; i < N - 1; i++) {
+                rows *= dims[i];
+            }
+            for (size_t r = 0; r < rows; r++) {
+                size_t offset = origin[N - 1];
+                size_t idx = r;
+                for (int i = N - 2; i >= 0; i--) {
+                    offset += (origin[i] + idx % dims[i]) * dimension_offsets[i];
+                    idx /= dims[i];
+                }
+                if (gather) {
+                    memcpy(chunk_data + r * row, global_data + offset, row * sizeof(T));
+                } else {
+                    memcpy(global_data + offset, chunk_data + r * row, row * sizeof(T));
+                }
+            }
+        }
+
+        Quantizer quantizer;
+        Encoder encoder;
+        Lossless lossless;
+        std::array<size_t, N> global_dimensions;
+        std::array<size_t, N> dimension_offsets;
+        std::array<size_t, N> chunk_counts;
+        size_t chunk_size;
+        size_t num_chunks;
+        size_t num_elements;
+        uint blocksize;
+        int interpolator_id;
+        int direction_sequence_id;
+        int interp_levels;
+        int num_threads = 1;
+        std::vector<std::unique_ptr<TileCompressor>> workers;
+        std::vector<std::array<size_t, N>> worker_dims;
+        std::vector<std::vector<T>> tile_buffers;
+        CompressionStats stats;
+        bool verbose = false;
+    };
+
+
+};
+
+
+#endif
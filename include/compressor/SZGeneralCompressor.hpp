@@ -8,6 +8,9 @@
 #include "utils/FileUtil.h"
 #include "utils/Config.hpp"
 #include "utils/Timer.hpp"
+#include "utils/CompressionStats.hpp"
+#include "utils/Workspace.hpp"
+#include "utils/OutputArena.hpp"
 #include "def.hpp"
 #include <cstring>
 
@@ -29,40 +32,101 @@ namespace SZ {
         }
 
         uchar *compress(T *data, size_t &compressed_size) {
+            reset();
+            stats.clear();
 
             Timer timer(true);
             std::vector<int> quant_inds = frontend.compress(data);
-            timer.stop("Prediction & Quantization");
-
-            uchar *compressed_data = new uchar[2 * quant_inds.size() * sizeof(T)];
-            uchar *compressed_data_pos = compressed_data;
+            stats.add_time("Prediction & Quantization", timer.stop());
 
+            // the output grows in the arena as it is written, each writer reserves a bound of its own
+            uchar *compressed_data_pos = arena.reserve(frontend.save_size_bound());
             frontend.save(compressed_data_pos);
+            arena.commit(compressed_data_pos);
 
             timer.start();
             encoder.preprocess_encode(quant_inds, 2 * frontend.get_radius());
+            compressed_data_pos = arena.reserve(encoder.save_size_bound() + encoder.encode_size_bound(quant_inds.size()));
             encoder.save(compressed_data_pos);
             encoder.encode(quant_inds, compressed_data_pos);
             encoder.postprocess_encode();
-            timer.stop("Encoder");
+            arena.commit(compressed_data_pos);
+            stats.add_time("Encoder", timer.stop());
 
             timer.start();
-            uchar *lossless_data = lossless.compress(compressed_data,
-                                                     compressed_data_pos - compressed_data,
-                                                     compressed_size);
-            lossless.postcompress_data(compressed_data);
-            timer.stop("Lossless");
+            uchar *lossless_data = lossless.compress(arena, compressed_size);
+            arena.rewind();
+            stats.add_time("Lossless", timer.stop());
+            stats.num_elements = quant_inds.size();
+            stats.compressed_bytes = compressed_size;
+            report();
 
             return lossless_data;
         }
 
+        // forget the predictor data and the unpredictable data of the previous calls, keeping their memory;
+        // compress starts with it, so one compressor serves many fields
+        void reset() {
+            frontend.clear();
+        }
+
         T *decompress(uchar const *lossless_compressed_data, const size_t length) {
+            auto &quant_inds = load(lossless_compressed_data, length);
+
+            Timer timer(true);
+            auto decom = frontend.decompress(quant_inds);
+            stats.add_time("Prediction & Recover", timer.stop());
+            report();
+            return decom;
+        }
+
+        T *decompress(uchar const *lossless_compressed_data, const size_t length, T *dec_data) {
+            auto &quant_inds = load(lossless_compressed_data, length);
+
+            Timer timer(true);
+            frontend.decompress(quant_inds, dec_data);
+            stats.add_time("Prediction & Recover", timer.stop());
+            report();
+            return dec_data;
+        }
+
+        // scratch memory of decompress, kept between calls
+        Workspace &get_workspace() {
+            return workspace;
+        }
+
+        // what the last compression or decompression measured
+        const CompressionStats &get_stats() const {
+            return stats;
+        }
+
+        // print the statistics at the end of every call, nothing is printed otherwise
+        void set_verbose(bool print) {
+            verbose = print;
+        }
+
+        bool get_verbose() const {
+            return verbose;
+        }
+
+    private:
+        // print the statistics of the last call when asked to
+        void report() const {
+            if (verbose) {
+                stats.print();
+            }
+        }
+
+        // the frontend settings and the quantization indices, in the workspace
+        std::vector<int> &load(uchar const *lossless_compressed_data, const size_t length) {
             size_t remaining_length = length;
+            stats.clear();
+            stats.compressed_bytes = length;
 
             Timer timer(true);
-            auto compressed_data = lossless.decompress(lossless_compressed_data, remaining_length);
+            auto compressed_data = lossless.decompress(lossless_compressed_data, remaining_length, workspace, 0);
             uchar const *compressed_data_pos = compressed_data;
-            timer.stop("Lossless");
+            stats.add_time("Lossless", timer.stop());
 
 
             frontend.load(compressed_data_pos, remaining_length);
@@ -70,23 +134,21 @@ namespace SZ {
             encoder.load(compressed_data_pos, remaining_length);
 
             timer.start();
-            auto quant_inds = encoder.decode(compressed_data_pos, frontend.get_num_elements());
+            stats.num_elements = frontend.get_num_elements();
+            auto &quant_inds = workspace.quant_inds(frontend.get_num_elements());
+            encoder.decode(compressed_data_pos, quant_inds.size(), quant_inds.data());
             encoder.postprocess_decode();
-            timer.stop("Decoder");
-
-            lossless.postdecompress_data(compressed_data);
-
-            timer.start();
-            auto decom = frontend.decompress(quant_inds);
-            timer.stop("Prediction & Recover");
-            return decom;
+            stats.add_time("Decoder", timer.stop());
+            return quant_inds;
         }
 
-
-    private:
         Frontend frontend;
         Encoder encoder;
         Lossless lossless;
+        Workspace workspace;
+        OutputArena arena;
+        CompressionStats stats;
+        bool verbose = false;
     };
 
     template<class T, uint N, class Frontend, class Encoder, class Lossless>
@@ -9,12 +9,25 @@
 #include "utils/Iterator.hpp"
 #include "utils/MemoryUtil.hpp"
 #include "utils/Config.hpp"
-#include "utils/FileUtil.h"
 #include "utils/Interpolators.hpp"
+#include "utils/InterpolatorsSIMD.hpp"
+#include "utils/InterpolationTuner.hpp"
+#include "utils/Workspace.hpp"
+#include "utils/OutputArena.hpp"
+#include "quantizer/IntegerQuantizer.hpp"
 #include "utils/Timer.hpp"
+#include "utils/CompressionStats.hpp"
 #include "def.hpp"
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace SZ {
     template<class T, uint N, class Quantizer, class Encoder, class Lossless>
@@ -30,8 +43,6 @@ namespace SZ {
                                   int interp_levels) :
                 quantizer(quantizer), encoder(encoder), lossless(lossless),
                 blocksize(blocksize), global_dimensions(dims),
-//                interpolators({"linear", "cubic", "cubic2", "akima", "pchip"}),
-                interpolators({"linear", "cubic"}),
                 interpolator_id(interpolator), direction_sequence_id(direction) {
             static_assert(std::is_base_of<concepts::QuantizerInterface<T>, Quantizer>::value,
                           "must implement the quatizer interface");
@@ -44,8 +55,9 @@ namespace SZ {
             num_elements = 1;
             interpolation_level = -1;
             for (int i = 0; i < N; i++) {
-                if (interpolation_level < ceil(log2(dims[i]))) {
-                    interpolation_level = (uint) ceil(log2(dims[i]));
+                dimension_levels[i] = (uint) ceil(log2(dims[i]));
+                if (interpolation_level < (int) dimension_levels[i]) {
+                    interpolation_level = dimension_levels[i];
                 }
                 num_elements *= dims[i];
             }
@@ -54,6 +66,7 @@ namespace SZ {
             for (int i = N - 2; i >= 0; i--) {
                 dimension_offsets[i] = dimension_offsets[i + 1] * global_dimensions[i + 1];
             }
+            view = {std::array<size_t, N>{}, dimension_offsets, 0};
 
             dimension_sequences = std::vector<std::array<int, N>>();
             auto sequence = std::array<int, N>();
@@ -63,465 +76,1796 @@ namespace SZ {
             do {
                 dimension_sequences.push_back(sequence);
             } while (std::next_permutation(sequence.begin(), sequence.end()));
+            // copies of the encoder and the lossless compressor before they are used
+            level_encoders.assign(interpolation_level, encoder);
+            level_lossless.assign(interpolation_level, lossless);
+            configured = {quantizer, interpolator_id, direction_sequence_id, eb_ratio};
+        }
 
+        // number of threads working on the blocks of one dimension pass, the output does not depend on it
+        void set_num_threads(int threads) {
+            num_threads = threads > 0 ? threads : 1;
+        }
 
-            size_t num_params=0;
-            
+        int get_num_threads() const {
+            return num_threads;
+        }
 
-            auto c_params=SZ::readfile<T>("c_params.dat",num_params);
-            if (num_params!=4){
-                std::cout<<"Read params failed."<<std::endl;
-                c_a=c_d=-1/16;
-                c_b=c_c=9/16;
-            }
-            else{
-                c_a=c_params[0];
-                c_b=c_params[1];
-                c_c=c_params[2];
-                c_d=c_params[3];
-            }
+        // size in bytes of the cache the finest levels are tiled for, 0 sweeps the whole array level by level;
+        // the output does not depend on it
+        void set_cache_size(size_t bytes) {
+            cache_size = bytes;
+        }
 
+        size_t get_cache_size() const {
+            return cache_size;
+        }
 
+        // store the quantization indices in 16 bits when the quantizer radius is at most 32768,
+        // the output does not depend on it
+        void set_compact_quant_inds(bool compact) {
+            compact_quant_inds = compact;
+        }
 
+        bool get_compact_quant_inds() const {
+            return compact_quant_inds;
         }
 
+        // store the quantization indices of every level in a section of its own, which lets decompress_level
+        // skip the fine levels without decoding them; the layout is stored in the stream
+        void set_level_sections(bool sections) {
+            level_sections = sections;
+        }
 
-        T *decompress(uchar *compressed_data, const size_t length, bool pre_de_lossless = false) {
-            size_t remaining_length = length;
-            uchar *lossless_decompressed;
-            uchar const *compressed_data_pos;
-            if (pre_de_lossless) {
-                compressed_data_pos = compressed_data;
-            } else {
-                lossless_decompressed = lossless.decompress(compressed_data, remaining_length);
-                compressed_data_pos = lossless_decompressed;
-                T eb;
-                read(eb, compressed_data_pos, remaining_length);
-            }
+        bool get_level_sections() const {
+            return level_sections;
+        }
 
-            read(global_dimensions.data(), N, compressed_data_pos, remaining_length);
-            num_elements = 1;
-            for (const auto &d : global_dimensions) {
-                num_elements *= d;
-                std::cout << d << " ";
-            }
-            std::cout << std::endl;
-            uint block_size = 0;
-            read(block_size, compressed_data_pos, remaining_length);
-            quantizer.load(compressed_data_pos, remaining_length);
-            encoder.load(compressed_data_pos, remaining_length);
-            quant_inds = encoder.decode(compressed_data_pos, num_elements);
+        // choose the interpolator, the dimension sequence and the eb_ratio at compression from a sample of the data,
+        // the choice is stored in the stream
+        void set_auto_tuning(bool tuning) {
+            auto_tuning = tuning;
+        }
 
-            encoder.postprocess_decode();
+        bool get_auto_tuning() const {
+            return auto_tuning;
+        }
 
-            if (!pre_de_lossless) {
-                lossless.postdecompress_data(lossless_decompressed);
-            }
-            double eb = quantizer.get_eb();
-//            quantizer.set_eb(eb * eb_ratio);
+        // ratio of the error bound of the levels from 3 up to the one of the finest levels
+        void set_eb_ratio(double ratio) {
+            eb_ratio = ratio;
+            configured.eb_ratio = ratio;
+        }
+
+        // the settings used by the last compression or decompression
+        int get_interpolator() const {
+            return interpolator_id;
+        }
 
+        int get_direction() const {
+            return direction_sequence_id;
+        }
+
+        // number of levels along every dimension, a dimension takes no part in the passes of the coarser levels
+        const std::array<uint, N> &get_dimension_levels() const {
+            return dimension_levels;
+        }
+
+        double get_eb_ratio() const {
+            return eb_ratio;
+        }
+
+        // give every level section its own entropy coder tree fitted to the indices of the level, the sections
+        // are then encoded and decoded in parallel; implies level sections, the layout is stored in the stream
+        void set_level_codebooks(bool codebooks) {
+            level_codebooks = codebooks;
+        }
+
+        bool get_level_codebooks() const {
+            return level_codebooks;
+        }
+
+        // choose linear, cubic or fitted cubic interpolation for every level and dimension at compression,
+        // from the prediction error on a sample of the data, the choice is stored in the stream.
+        // With auto tuning, the tuner leaves out the eb_ratio of 1 for it
+        void set_level_interpolators(bool adaptive) {
+            adaptive_interpolators = adaptive;
+        }
+
+        bool get_level_interpolators() const {
+            return adaptive_interpolators;
+        }
+
+        T *decompress(uchar const *compressed_data, const size_t length, bool pre_de_lossless = false) {
+            load_stream(compressed_data, length, pre_de_lossless);
 //            auto dec_data = std::make_shared<T[]>(num_elements);
             T *dec_data = new T[num_elements];
+            reconstruct(dec_data);
+            return dec_data;
+        }
 
-//            quantizer.set_eb(eb);
-            Timer timer;
-            timer.start();
+        // decompress into dec_data, allocated by the caller for all the elements, returns dec_data.
+        // The lossless buffers come from the workspace and the quantization indices are kept by the compressor,
+        // so decompressing again with the same compressor allocates nothing
+        T *decompress(uchar const *compressed_data, const size_t length, T *dec_data) {
+            load_stream(compressed_data, length, false);
+            reconstruct(dec_data);
+            return dec_data;
+        }
 
-            *dec_data = quantizer.recover(0, quant_inds[quant_index++]);
+        // scratch memory of decompression, kept between calls
+        Workspace &get_workspace() {
+            return workspace;
+        }
 
-            for (uint level = interpolation_level; level > 0 && level <= interpolation_level; level--) {
-                if (level >= 3) {
-                    quantizer.set_eb(eb * eb_ratio);
-                } else {
-                    quantizer.set_eb(eb);
-                }
-                size_t stride = 1U << (level - 1);
-                auto inter_block_range = std::make_shared<
-                        SZ::multi_dimensional_range<T, N>>(dec_data,
-                                                           std::begin(global_dimensions), std::end(global_dimensions),
-                                                           stride * blocksize, 0);
-                auto inter_begin = inter_block_range->begin();
-                auto inter_end = inter_block_range->end();
-                for (auto block = inter_begin; block != inter_end; ++block) {
-                    auto end_idx = block.get_global_index();
+        // what the last compression or decompression measured, of the last field for a batch
+        const CompressionStats &get_stats() const {
+            return stats;
+        }
+
+        // print the settings and the statistics at the end of every call, nothing is printed otherwise
+        void set_verbose(bool print) {
+            verbose = print;
+        }
+
+        bool get_verbose() const {
+            return verbose;
+        }
+
+        // decompress the levels down to `level` only and return the grid of their points, the ones at multiples
+        // of 2^(level - 1), whose dimensions are stored in coarse_dims.
+        // With level sections the finer levels are not even decoded.
+        T *decompress_level(uchar const *compressed_data, const size_t length, uint level,
+                            std::array<size_t, N> &coarse_dims) {
+            level = std::max(1U, std::min(level, (uint) interpolation_level));
+            load_stream(compressed_data, length, false, level);
+            T *dec_data = new T[num_elements];
+            reconstruct(dec_data, level);
+            size_t stride = 1UL << (level - 1);
+            for (int i = 0; i < N; i++) {
+                coarse_dims[i] = (global_dimensions[i] - 1) / stride + 1;
+            }
+            if (stride == 1) {
+                return dec_data;
+            }
+            size_t coarse_size = grid_points(stride);
+            T *coarse_data = new T[coarse_size];
+            std::array<size_t, N> idx{};
+            for (size_t c = 0; c < coarse_size; c++) {
+                size_t offset = 0;
+                for (int i = 0; i < N; i++) {
+                    offset += idx[i] * stride * dimension_offsets[i];
+                }
+                coarse_data[c] = dec_data[offset];
+                for (int i = N - 1; i >= 0; i--) {
+                    if (++idx[i] < coarse_dims[i]) {
+                        break;
+                    }
+                    idx[i] = 0;
+                }
+            }
+            delete[] dec_data;
+            return coarse_data;
+        }
+
+        // decompress the box [begin, end) only, returned in row-major order.
+        // Every level reconstructs the lines the box depends on through the interpolation stencils, in a buffer
+        // of its own points around them; with level sections the indices of the other blocks are not decoded
+        T *decompress_region(uchar const *compressed_data, const size_t length,
+                             const std::array<size_t, N> &begin, const std::array<size_t, N> &end) {
+            stream_indices indices = load_header(compressed_data, length, false);
+            size_t region_size = 1;
+            region_box box;
+            for (int i = 0; i < N; i++) {
+                assert(begin[i] < end[i] && end[i] <= global_dimensions[i]);
+                box.lo[i] = begin[i];
+                box.hi[i] = end[i] - 1;
+                region_size *= end[i] - begin[i];
+            }
+            // walk the levels from the finest one, the points needed before a pass are the ones needed after it
+            // and the stencil points along the pass dimension, at most 5 strides away
+            const std::array<int, N> &dims = dimension_sequences[direction_sequence_id];
+            region_boxes.resize(interpolation_level * N);
+            std::vector<region_box> level_boxes(interpolation_level + 1); // before the first pass of a level
+            for (uint level = 1; level <= interpolation_level; level++) {
+                size_t reach = 5UL << (level - 1);
+                for (int pass = N - 1; pass >= 0; pass--) {
+                    region_boxes[(level - 1) * N + pass] = box;
+                    int dim = dims[pass];
+                    box.lo[dim] = box.lo[dim] > reach ? box.lo[dim] - reach : 0;
+                    box.hi[dim] = std::min(box.hi[dim] + reach, global_dimensions[dim] - 1);
+                }
+                level_boxes[level] = box;
+            }
+            // the blocks of a level meeting its box are the only ones interpolated
+            std::vector<level_plan> plans(interpolation_level + 1);
+            size_t quant_count = 1;
+            for (uint level = interpolation_level; level > 0; level--) {
+                uint stride = 1U << (level - 1);
+                level_plan &plan = plans[level];
+                plan = plan_level(stride, quant_count);
+                for (size_t b = 0; b < plan.blocks.size(); b++) {
+                    auto block_last = block_end(plan.blocks[b], stride);
+                    bool meets = true;
                     for (int i = 0; i < N; i++) {
-                        end_idx[i] += stride * blocksize;
-                        if (end_idx[i] > global_dimensions[i] - 1) {
-                            end_idx[i] = global_dimensions[i] - 1;
-                        }
+                        meets = meets && plan.blocks[b][i] <= level_boxes[level].hi[i] &&
+                                block_last[i] >= level_boxes[level].lo[i];
+                    }
+                    if (meets) {
+                        plan.region_blocks.push_back(b);
                     }
-                    block_interpolation(dec_data, block.get_global_index(), end_idx, PB_recover,
-                                        interpolators[interpolator_id], direction_sequence_id, stride);
                 }
             }
-            std::cout << "Total quant element = " << quant_inds.size() << std::endl;
+            decode_indices(indices, 1, &plans);
+
+            Timer timer(true);
+            T eb = quantizer.get_eb();
+            interp_cursor anchor{0, 0, nullptr, nullptr};
+            T anchor_value = 0;
+            recover(anchor, anchor_value, 0);
+            size_t unpred_count = anchor.unpred_pos;
+            std::vector<T> coarse, fine;
+            std::array<size_t, N> fine_last{};
+            grid_view coarse_view = view, full_view = view;
+            for (uint level = interpolation_level; level > 0; level--) {
+                uint stride = 1U << (level - 1);
+                level_plan &plan = plans[level];
+                plan_region_unpred(plan, unpred_count, level);
+                // the points at multiples of stride of the blocks meeting the box of the level
+                size_t block_span = blocksize * stride, size = 1;
+                view.shift = level - 1;
+                for (int i = N - 1; i >= 0; i--) {
+                    size_t lo = level_boxes[level].lo[i];
+                    view.origin[i] = lo ? (lo - 1) / block_span * block_span : 0;
+                    fine_last[i] = std::min(level_boxes[level].hi[i] / block_span * block_span + block_span,
+                                            global_dimensions[i] - 1);
+                    view.offsets[i] = size;
+                    size *= ((fine_last[i] - view.origin[i]) >> view.shift) + 1;
+                }
+                fine.assign(size, 0);
+                if (level == interpolation_level) {
+                    if (view.origin == std::array<size_t, N>{}) {
+                        fine[0] = anchor_value;
+                    }
+                } else {
+                    copy_coarse(coarse.data(), coarse_view, fine.data(), view, fine_last, 2 * stride);
+                }
+                set_level_eb(eb, level);
+                for (uint pass = 0; pass < N; pass++) {
+                    interpolation_pass<PB_recover>(fine.data(), plan, plan.region_blocks, pass, stride);
+                }
+                coarse.swap(fine);
+                coarse_view = view;
+            }
+            view = full_view;
+            std::vector<region_box>().swap(region_boxes);
             quantizer.postdecompress_data();
-            timer.stop("Interpolation Decompress");
 
-            return dec_data;
+            T *region_data = new T[region_size];
+            std::array<size_t, N> idx = begin;
+            for (size_t r = 0; r < region_size; r += end[N - 1] - begin[N - 1]) {
+                size_t offset = 0;
+                for (int i = 0; i < N; i++) {
+                    offset += (idx[i] - coarse_view.origin[i]) * coarse_view.offsets[i];
+                }
+                std::copy(coarse.data() + offset, coarse.data() + offset + end[N - 1] - begin[N - 1], region_data + r);
+                for (int i = N - 2; i >= 0; i--) {
+                    if (++idx[i] < end[i]) {
+                        break;
+                    }
+                    idx[i] = begin[i];
+                }
+            }
+            stats.add_time("Reconstruction", timer.stop());
+            report();
+            return region_data;
         }
 
         uchar *compress(T *data, size_t &compressed_size) {
             return compress(data, compressed_size, false);
         }
 
-        // compress given the error bound
+        // compress given the error bound, from the configured settings
         uchar *compress(T *data, size_t &compressed_size, bool deleteData) {
-            quant_inds.reserve(num_elements);
-//            quant_inds.resize(num_elements);
+            reset();
+            return compress_field(data, compressed_size, deleteData);
+        }
+
+        // compress fields of the dimensions of the compressor one after the other, into streams of their own
+        // released with delete[]; the fields are overwritten as by compress.
+        // The quantization indices, the coder trees, the output arena, the lossless contexts and the tuning samples
+        // set up for the first field serve the others
+        std::vector<uchar *> compress_batch(const std::vector<T *> &fields, std::vector<size_t> &compressed_sizes) {
+            std::vector<uchar *> streams(fields.size());
+            compressed_sizes.resize(fields.size());
+            for (size_t f = 0; f < fields.size(); f++) {
+                reset();
+                streams[f] = compress_field(fields[f], compressed_sizes[f], false);
+            }
+            return streams;
+        }
+
+        // decompress streams of compress into the buffers of the caller, the workspace of the first stream
+        // serves the others
+        void decompress_batch(const std::vector<uchar const *> &streams, const std::vector<size_t> &lengths,
+                              const std::vector<T *> &fields) {
+            assert(streams.size() == lengths.size() && streams.size() == fields.size());
+            for (size_t f = 0; f < streams.size(); f++) {
+                decompress(streams[f], lengths[f], fields[f]);
+            }
+        }
+
+        // go back to the configured settings, which a decompression replaces by the ones of its stream,
+        // and forget the data of the previous calls while keeping their memory; compress starts with it
+        void reset() {
+            quantizer = configured.quantizer;
+            interpolator_id = configured.interpolator;
+            direction_sequence_id = configured.direction;
+            eb_ratio = configured.eb_ratio;
+            cubic_coeffs.clear();
+            level_interpolators.clear();
+            arena.rewind();
+        }
+
+    private:
+
+        enum PredictorBehavior {
+            PB_predict_overwrite, PB_predict, PB_recover
+        };
+
+        // first byte of a stream, tells how the quantization indices follow the header
+        enum StreamLayout : uchar {
+            SL_plain, SL_level_sections, SL_level_codebooks
+        };
+
+        // blocks of one level and the stream offsets of every (block, dimension pass)
+        struct level_plan {
+            std::array<size_t, N> block_counts;
+            std::vector<std::array<size_t, N>> blocks;
+            std::vector<size_t> quant_offsets; // followed by the end of the level
+            std::vector<size_t> unpred_offsets; // decompression only
+            std::vector<size_t> region_blocks; // the ones a region needs, region decompression only
+            std::vector<size_t> block_unpred; // unpredictable points of every block, from a level section
+        };
+
+        // closed box of points, inclusive bounds
+        struct region_box {
+            std::array<size_t, N> lo, hi;
+        };
+
+        // addressing of the buffer being interpolated, point x is at sum(((x[i] - origin[i]) >> shift) * offsets[i]).
+        // The whole grid has origin 0, shift 0 and dimension_offsets; region decompression keeps the points
+        // of a level, at multiples of its stride, of a box around the region
+        struct grid_view {
+            std::array<size_t, N> origin;
+            std::array<size_t, N> offsets;
+            uint shift;
+        };
+
+        // compress one field given the error bound, the output arena is left for the next field
+        uchar *compress_field(T *data, size_t &compressed_size, bool deleteData) {
+            init_quant_inds();
             size_t interp_compressed_size = 0;
 //            debug.resize(num_elements, 0);
 //            preds.resize(num_elements, 0);
 
             T eb = quantizer.get_eb();
-            std::cout << "Absolute error bound = " << eb << std::endl;
+            stats.clear();
+            stats.num_elements = num_elements;
+            stats.error_bound = eb;
+            if (auto_tuning) {
+                Timer timer(true);
+                // the samples only depend on the dimensions, they serve every field
+                if (!tuner) {
+                    tuner = std::make_shared<const InterpolationTuner<T, N>>(global_dimensions, dimension_sequences,
+                                                                             interpolation_level);
+                }
+                auto choice = tuner->tune(data, eb, quantizer.get_radius(), adaptive_interpolators);
+                interpolator_id = choice.interpolator;
+                direction_sequence_id = choice.direction;
+                eb_ratio = choice.eb_ratio;
+                stats.add_time("Tuning", timer.stop());
+            }
 //            quantizer.set_eb(eb * eb_ratio);
 
-//            quant_inds[0] = quantizer.quantize_and_overwrite(*data, 0);
-//            preds[0] = 0;
-            quant_inds.push_back(quantizer.quantize_and_overwrite(*data, 0));
+            // every thread keeps its own unpredictable data together with their stream positions,
+            // they are merged in stream order afterwards so the output does not depend on the thread count
+            unpred_buffers.assign(num_threads, std::vector<std::pair<size_t, T>>());
+            // every thread counts every level apart, quant_freqs[thread * levels + level - 1]; the histograms are
+            // kept for the next field, which saves allocating them for every tile of a chunked compressor
+            quant_freqs.resize(fused_histogram ? num_threads * interpolation_level : 0);
+            for (auto &freq:quant_freqs) {
+                freq.assign(2 * quantizer.get_radius(), 0);
+            }
+            interp_cursor anchor{0, 0, &unpred_buffers[0], fused_histogram ? level_freq(0, interpolation_level) : nullptr};
+            quantize(anchor, *data, 0);
+            size_t quant_count = anchor.quant_pos;
+            size_t unpred_count = 0;
 
             Timer timer;
             timer.start();
-
-            for (uint level = interpolation_level; level > 0 && level <= interpolation_level; level--) {
-                if (level >= 3) {
-                    quantizer.set_eb(eb * eb_ratio);
-                } else {
-                    quantizer.set_eb(eb);
+            fit_cubic_coeffs(data);
+            interpolate_levels<PB_predict_overwrite>(data, eb, quant_count, unpred_count);
+            if (!level_interpolators.empty() && std::find(level_interpolators.begin(), level_interpolators.end(),
+                                                          (uchar) INTERP_ALGO_CUBIC_P) == level_interpolators.end()) {
+                // no level uses the fitted coefficients, they are left out of the stream
+                cubic_coeffs.clear();
+            }
+            {
+                std::vector<std::pair<size_t, T>> unpred_pos;
+                for (auto &buffer:unpred_buffers) {
+                    unpred_pos.insert(unpred_pos.end(), buffer.begin(), buffer.end());
+                    std::vector<std::pair<size_t, T>>().swap(buffer);
                 }
-                uint stride = 1U << (level - 1);
-//                std::cout << "Level = " << level << ", stride = " << stride << std::endl;
-
-                auto inter_block_range = std::make_shared<
-                        SZ::multi_dimensional_range<T, N>>(data, std::begin(global_dimensions),
-                                                           std::end(global_dimensions),
-                                                           blocksize * stride, 0);
-
-                auto inter_begin = inter_block_range->begin();
-                auto inter_end = inter_block_range->end();
-                for (auto block = inter_begin; block != inter_end; ++block) {
-                    auto end_idx = block.get_global_index();
-                    for (int i = 0; i < N; i++) {
-                        end_idx[i] += blocksize * stride;
-                        if (end_idx[i] > global_dimensions[i] - 1) {
-                            end_idx[i] = global_dimensions[i] - 1;
-                        }
-                    }
-
-                    block_interpolation(data, block.get_global_index(), end_idx, PB_predict_overwrite,
-                                        interpolators[interpolator_id], direction_sequence_id, stride);
+                std::sort(unpred_pos.begin(), unpred_pos.end(),
+                          [](const std::pair<size_t, T> &a, const std::pair<size_t, T> &b) {
+                              return a.first < b.first;
+                          });
+                std::vector<T> unpred(unpred_pos.size());
+                for (size_t i = 0; i < unpred_pos.size(); i++) {
+                    unpred[i] = unpred_pos[i].second;
                 }
+                quantizer.set_unpred(std::move(unpred));
             }
             if (deleteData) {
                 delete[]data;
             }
-            std::cout << "total element = " << num_elements << std::endl;
-            std::cout << "quantization element = " << quant_inds.size() << std::endl;
-            assert(quant_inds.size() == num_elements);
-            timer.stop("Predition & Quantization");
+            assert(quant_count == num_elements);
+            stats.unpredictable = quantizer.get_unpred().size();
+            stats.add_time("Prediction & Quantization", timer.stop());
+            fill_level_entropy();
+            timer.start();
 
 //            writefile("pred.dat", preds.data(), num_elements);
 //            writefile("quant.dat", quant_inds.data(), num_elements);
-            //TODO find a better estimation method
-            uchar *compressed_data = (num_elements < 1000000) ?
-                                     new uchar[4 * num_elements * sizeof(T)] :
-                                     new uchar[size_t(1.2 * num_elements) * sizeof(T)];
-            uchar *compressed_data_pos = compressed_data;
+            // the output grows in the arena as it is written, each writer reserves a bound of its own
+            uchar *compressed_data_pos = arena.reserve(header_size_bound());
             write(eb, compressed_data_pos);
             write(global_dimensions.data(), N, compressed_data_pos);
             write(blocksize, compressed_data_pos);
+            write(interpolator_id, compressed_data_pos);
+            write(direction_sequence_id, compressed_data_pos);
+            write(eb_ratio, compressed_data_pos);
+            write(cubic_coeffs.size(), compressed_data_pos);
+            write(cubic_coeffs.data(), cubic_coeffs.size(), compressed_data_pos);
+            write(level_interpolators.size(), compressed_data_pos);
+            write(level_interpolators.data(), level_interpolators.size(), compressed_data_pos);
 
             quantizer.save(compressed_data_pos);
             quantizer.postcompress_data();
 
-            encoder.preprocess_encode(quant_inds, 4 * quantizer.get_radius());
-            encoder.save(compressed_data_pos);
-            encoder.encode(quant_inds, compressed_data_pos);
+            size_t encoded_size = 0;
+            if (level_codebooks) {
+                // the trees are built with the sections
+            } else if constexpr (fused_histogram) {
+                std::vector<size_t> &freq = quant_freqs[0];
+                for (size_t t = 1; t < quant_freqs.size(); t++) {
+                    for (size_t i = 0; i < freq.size(); i++) {
+                        freq[i] += quant_freqs[t][i];
+                    }
+                }
+                encoder.preprocess_encode_freq(freq.data(), freq.size(), 4 * quantizer.get_radius());
+                encoded_size = encoded_size_bound(encoder, &freq, num_elements);
+            } else {
+                with_quant_inds([&](auto *quant) {
+                    encoder.preprocess_encode(quant, num_elements, 4 * quantizer.get_radius());
+                });
+                encoded_size = encoded_size_bound(encoder, nullptr, num_elements);
+            }
+            if (!level_codebooks) {
+                encoder.save(compressed_data_pos);
+            }
+            arena.commit(compressed_data_pos);
+            if (level_sections || level_codebooks) {
+                // the header is followed by one section per level from the coarsest one,
+                // each compressed on its own so that a decoder can stop before the fine levels
+                std::vector<uchar *> sections(interpolation_level);
+                std::vector<size_t> section_sizes(interpolation_level);
+                if (level_codebooks) {
+                    // every section has an encoder of its own, the finest levels are the largest and start first
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+                    for (ptrdiff_t l = 0; l < (ptrdiff_t) interpolation_level; l++) {
+                        sections[interpolation_level - 1 - l] = encode_section(l + 1, level_encoders[l], level_lossless[l], true,
+                                                                               section_sizes[interpolation_level - 1 - l]);
+                    }
+                } else {
+                    for (uint level = interpolation_level; level > 0; level--) {
+                        sections[interpolation_level - level] = encode_section(level, encoder, lossless, false,
+                                                                               section_sizes[interpolation_level - level]);
+                    }
+                    encoder.postprocess_encode();
+                }
+                stats.add_time("Encoding", timer.stop());
+                timer.start();
+                size_t header_size = 0;
+                std::unique_ptr<uchar[]> header(lossless.compress(arena, header_size));
+                stats.add_time("Lossless", timer.stop());
+                stats.section_bytes.push_back(header_size);
+                stats.section_bytes.insert(stats.section_bytes.end(), section_sizes.begin(), section_sizes.end());
+                compressed_size = sizeof(uchar) + (2 + sections.size()) * sizeof(size_t) + header_size;
+                for (auto size:section_sizes) {
+                    compressed_size += size;
+                }
+                uchar *lossless_data = new uchar[compressed_size];
+                uchar *lossless_data_pos = lossless_data;
+                write((uchar) (level_codebooks ? SL_level_codebooks : SL_level_sections), lossless_data_pos);
+                write(header_size, lossless_data_pos);
+                write(sections.size(), lossless_data_pos);
+                write(section_sizes.data(), section_sizes.size(), lossless_data_pos);
+                write(header.get(), header_size, lossless_data_pos);
+                for (size_t i = 0; i < sections.size(); i++) {
+                    write(sections[i], section_sizes[i], lossless_data_pos);
+                    delete[] sections[i];
+                }
+                stats.compressed_bytes = compressed_size;
+                report();
+                return lossless_data;
+            }
+            compressed_data_pos = arena.reserve(encoded_size);
+            with_quant_inds([&](auto *quant) {
+                encoder.encode(quant, num_elements, compressed_data_pos);
+            });
+            arena.commit(compressed_data_pos);
             encoder.postprocess_encode();
+            stats.add_time("Encoding", timer.stop());
 
-            uchar *lossless_data = lossless.compress(compressed_data,
-                                                     compressed_data_pos - compressed_data,
-                                                     compressed_size);
-            lossless.postcompress_data(compressed_data);
+            timer.start();
+            // the layout byte goes in front of the lossless output, in the same buffer
+            uchar *stream = lossless.compress(arena, compressed_size, sizeof(uchar));
+            stats.add_time("Lossless", timer.stop());
+            uchar *stream_pos = stream;
+            write((uchar) SL_plain, stream_pos);
 
             compressed_size += interp_compressed_size;
-            return lossless_data;
+            stats.compressed_bytes = compressed_size;
+            report();
+            return stream;
         }
 
-    private:
+        // bits per index of every level, from the histograms of the threads or from the indices themselves
+        void fill_level_entropy() {
+            stats.level_entropy.assign(interpolation_level, 0);
+            std::vector<size_t> freq(2 * quantizer.get_radius());
+            for (uint level = 1; level <= interpolation_level; level++) {
+                if constexpr (fused_histogram) {
+                    if (num_threads == 1) {
+                        // the histogram of the only thread is the one of the level
+                        const std::vector<size_t> &level_freq = quant_freqs[level - 1];
+                        stats.level_entropy[level - 1] = CompressionStats::entropy(level_freq.data(), level_freq.size());
+                        continue;
+                    }
+                }
+                std::fill(freq.begin(), freq.end(), 0);
+                if constexpr (fused_histogram) {
+                    for (size_t t = 0; t < num_threads; t++) {
+                        const std::vector<size_t> &thread_freq = quant_freqs[t * interpolation_level + level - 1];
+                        for (size_t i = 0; i < freq.size(); i++) {
+                            freq[i] += thread_freq[i];
+                        }
+                    }
+                } else {
+                    auto range = section_range(level);
+                    with_quant_inds([&](auto *quant) {
+                        for (size_t i = range.first; i < range.second; i++) {
+                            freq[quant[i]]++;
+                        }
+                    });
+                }
+                stats.level_entropy[level - 1] = CompressionStats::entropy(freq.data(), freq.size());
+            }
+        }
 
-        enum PredictorBehavior {
-            PB_predict_overwrite, PB_predict, PB_recover
+        // print the settings and the statistics of the last call when asked to
+        void report() const {
+            if (verbose) {
+                printf("interpolator = %d, direction = %d, eb_ratio = %g\n", interpolator_id, direction_sequence_id,
+                       eb_ratio);
+                stats.print();
+            }
+        }
+
+        // where the encoded quantization indices of a stream are, found by load_header
+        struct stream_indices {
+            uchar layout;
+            uchar const *plain; // after the header in the plain layout
+            std::vector<uchar const *> sections; // of level - 1 otherwise
+            std::vector<size_t> section_sizes;
+        };
+
+        // read the header and decode the quantization indices of the levels down to last_level,
+        // which are all of them unless the stream has level sections
+        void load_stream(uchar const *compressed_data, const size_t length, bool pre_de_lossless,
+                         uint last_level = 1) {
+            decode_indices(load_header(compressed_data, length, pre_de_lossless), last_level);
+        }
+
+        // read the header up to the encoded quantization indices.
+        // A stream already through the lossless decompressor has no layout byte and is plain
+        stream_indices load_header(uchar const *compressed_data, const size_t length, bool pre_de_lossless) {
+            size_t remaining_length = length;
+            uchar const *compressed_data_pos;
+            stream_indices indices{SL_plain, nullptr, {}, {}};
+            stats.clear();
+            stats.compressed_bytes = length;
+            Timer timer(true);
+            // buffer 0 for the header, buffer level for the section of a level
+            workspace.reserve(interpolation_level + 1);
+            if (!pre_de_lossless) {
+                read(indices.layout, compressed_data, remaining_length);
+            }
+            if (indices.layout > SL_level_codebooks) {
+                throw std::runtime_error("unknown stream layout " + std::to_string(indices.layout));
+            }
+            if (indices.layout != SL_plain) {
+                // the sizes of the header and the sections come first, the header is always compressed
+                size_t header_size = 0, num_sections = 0;
+                read(header_size, compressed_data, remaining_length);
+                read(num_sections, compressed_data, remaining_length);
+                if (num_sections != (size_t) interpolation_level) {
+                    throw std::runtime_error("stream has " + std::to_string(num_sections) + " level sections for " +
+                                             std::to_string(interpolation_level) + " levels");
+                }
+                std::vector<size_t> section_sizes(num_sections);
+                read(section_sizes.data(), num_sections, compressed_data, remaining_length);
+                // the sections follow the header from the coarsest level
+                uchar const *section = compressed_data + header_size;
+                indices.sections.resize(num_sections);
+                indices.section_sizes.resize(num_sections);
+                for (size_t i = 0; i < num_sections; i++) {
+                    indices.sections[num_sections - 1 - i] = section;
+                    indices.section_sizes[num_sections - 1 - i] = section_sizes[i];
+                    section += section_sizes[i];
+                }
+                remaining_length = header_size;
+                stats.section_bytes.push_back(header_size);
+                stats.section_bytes.insert(stats.section_bytes.end(), section_sizes.begin(), section_sizes.end());
+            }
+            if (pre_de_lossless) {
+                compressed_data_pos = compressed_data;
+            } else {
+                compressed_data_pos = lossless.decompress(compressed_data, remaining_length, workspace, 0);
+                T eb;
+                read(eb, compressed_data_pos, remaining_length);
+            }
+            stats.add_time("Lossless", timer.stop());
+
+            read(global_dimensions.data(), N, compressed_data_pos, remaining_length);
+            num_elements = 1;
+            for (const auto &d : global_dimensions) {
+                num_elements *= d;
+            }
+            uint block_size = 0;
+            read(block_size, compressed_data_pos, remaining_length);
+            read(interpolator_id, compressed_data_pos, remaining_length);
+            read(direction_sequence_id, compressed_data_pos, remaining_length);
+            read(eb_ratio, compressed_data_pos, remaining_length);
+            size_t num_coeffs = 0;
+            read(num_coeffs, compressed_data_pos, remaining_length);
+            cubic_coeffs.resize(num_coeffs);
+            read(cubic_coeffs.data(), num_coeffs, compressed_data_pos, remaining_length);
+            size_t num_interpolators = 0;
+            read(num_interpolators, compressed_data_pos, remaining_length);
+            level_interpolators.resize(num_interpolators);
+            read(level_interpolators.data(), num_interpolators, compressed_data_pos, remaining_length);
+            quantizer.load(compressed_data_pos, remaining_length);
+            stats.num_elements = num_elements;
+            stats.error_bound = quantizer.get_eb();
+            stats.unpredictable = quantizer.get_unpred().size();
+            if (indices.layout != SL_level_codebooks) {
+                encoder.load(compressed_data_pos, remaining_length);
+            }
+            indices.plain = compressed_data_pos;
+            init_quant_inds();
+            return indices;
+        }
+
+        // decode the quantization indices of the levels down to last_level, with level sections only the blocks
+        // of plans[level].region_blocks if plans are given
+        void decode_indices(const stream_indices &indices, uint last_level, std::vector<level_plan> *plans = nullptr) {
+            Timer timer(true);
+            if (indices.layout == SL_level_codebooks) {
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+                for (ptrdiff_t l = last_level - 1; l < (ptrdiff_t) interpolation_level; l++) {
+                    decode_section(l + 1, level_encoders[l], level_lossless[l], true, indices.sections[l],
+                                   indices.section_sizes[l], plans ? &(*plans)[l + 1] : nullptr);
+                }
+            } else if (indices.layout == SL_level_sections) {
+                for (uint level = interpolation_level; level >= last_level && level > 0; level--) {
+                    decode_section(level, encoder, lossless, false, indices.sections[level - 1],
+                                   indices.section_sizes[level - 1], plans ? &(*plans)[level] : nullptr);
+                }
+            } else {
+                uchar const *encoded = indices.plain;
+                with_quant_inds([&](auto *quant) {
+                    encoder.decode(encoded, num_elements, quant);
+                });
+            }
+
+            encoder.postprocess_decode();
+            stats.add_time("Decoding", timer.stop());
+        }
+
+        // number of grid points at multiples of stride along every dimension
+        size_t grid_points(size_t stride) const {
+            size_t points = 1;
+            for (int i = 0; i < N; i++) {
+                points *= (global_dimensions[i] - 1) / stride + 1;
+            }
+            return points;
+        }
+
+        // A level predicts the points at multiples of its stride that are not on the grid of the next coarser one,
+        // so its indices take [grid_points(2 * stride), grid_points(stride)) in the stream.
+        // The section of the coarsest level starts with the anchor.
+        std::pair<size_t, size_t> section_range(uint level) const {
+            size_t stride = 1UL << (level - 1);
+            return {level == interpolation_level ? 0 : grid_points(2 * stride), grid_points(stride)};
+        }
+
+        // entropy code the indices of one level, preceded by their own tree with codebook,
+        // then compress them on their own
+        uchar *encode_section(uint level, Encoder &section_encoder, Lossless &section_lossless, bool codebook,
+                              size_t &section_size) {
+            auto range = section_range(level);
+            size_t num = range.second - range.first;
+            // sections are encoded in parallel, each into an arena of its own
+            OutputArena section_arena(0);
+            uchar *buffer_pos;
+            size_t encoded_size = 0;
+            if (codebook) {
+                buffer_pos = section_arena.reserve(tree_size_bound());
+                if constexpr (fused_histogram) {
+                    std::vector<size_t> freq(quant_freqs[level - 1]);
+                    for (size_t t = 1; t < num_threads; t++) {
+                        const std::vector<size_t> &thread_freq = quant_freqs[t * interpolation_level + level - 1];
+                        for (size_t i = 0; i < freq.size(); i++) {
+                            freq[i] += thread_freq[i];
+                        }
+                    }
+                    section_encoder.preprocess_encode_freq(freq.data(), freq.size(), 4 * quantizer.get_radius());
+                    encoded_size = encoded_size_bound(section_encoder, &freq, num);
+                } else {
+                    with_quant_inds([&](auto *quant) {
+                        section_encoder.preprocess_encode(quant + range.first, num, 4 * quantizer.get_radius());
+                    });
+                    encoded_size = encoded_size_bound(section_encoder, nullptr, num);
+                }
+                section_encoder.save(buffer_pos);
+                section_arena.commit(buffer_pos);
+            } else {
+                encoded_size = encoded_size_bound(section_encoder, nullptr, num);
+            }
+            // the blocks are encoded one after the other behind a table of their sizes and unpredictable points,
+            // from which a decoder can pick out the blocks it needs
+            std::vector<size_t> starts = section_blocks(level);
+            size_t num_blocks = starts.size() - 1;
+            std::vector<size_t> block_sizes(num_blocks), block_unpred(num_blocks);
+            buffer_pos = section_arena.reserve((1 + 2 * num_blocks) * sizeof(size_t));
+            write(num_blocks, buffer_pos);
+            uchar *table_pos = buffer_pos;
+            buffer_pos += 2 * num_blocks * sizeof(size_t);
+            section_arena.commit(buffer_pos);
+            // every block adds a header, a partial byte and the slack of its own
+            buffer_pos = section_arena.reserve(encoded_size + num_blocks * (sizeof(size_t) + 17));
+            with_quant_inds([&](auto *quant) {
+                for (size_t b = 0; b < num_blocks; b++) {
+                    uchar *block_pos = buffer_pos;
+                    section_encoder.encode(quant + starts[b], starts[b + 1] - starts[b], buffer_pos);
+                    block_sizes[b] = buffer_pos - block_pos;
+                    block_unpred[b] = std::count(quant + starts[b], quant + starts[b + 1], 0);
+                }
+            });
+            section_arena.commit(buffer_pos);
+            write(block_sizes.data(), num_blocks, table_pos);
+            write(block_unpred.data(), num_blocks, table_pos);
+            if (codebook) {
+                section_encoder.postprocess_encode();
+            }
+            return section_lossless.compress(section_arena, section_size);
+        }
+
+        // the indices of a level section cut at the blocks of the level, the first block of the coarsest level
+        // also takes the anchor; the start of every block followed by the end of the section
+        std::vector<size_t> section_blocks(uint level) const {
+            auto range = section_range(level);
+            size_t quant_count = level == interpolation_level ? 1 : range.first;
+            auto plan = plan_level(1U << (level - 1), quant_count);
+            assert(quant_count == range.second);
+            std::vector<size_t> starts(plan.blocks.size() + 1);
+            for (size_t b = 1; b < plan.blocks.size(); b++) {
+                starts[b] = plan.quant_offsets[b * N];
+            }
+            starts.front() = range.first;
+            starts.back() = range.second;
+            return starts;
+        }
+
+        // room for the header written before the encoded indices
+        size_t header_size_bound() const {
+            return 256 + N * sizeof(size_t) + cubic_coeffs.size() * sizeof(cubic_coeffs[0]) +
+                   level_interpolators.size() + quantizer.get_unpred().size() * sizeof(T) +
+                   (level_codebooks ? 0 : tree_size_bound());
+        }
+
+        // room for a tree of all the states
+        size_t tree_size_bound() const {
+            return 8 * quantizer.get_radius() * (2 * sizeof(uint) + 1 + sizeof(int)) + 64;
+        }
+
+        // room for num encoded indices, exact from their histogram when the encoder can tell
+        size_t encoded_size_bound(const Encoder &enc, const std::vector<size_t> *freq, size_t num) const {
+            if constexpr (concepts::has_encoded_size<Encoder>::value) {
+                if (freq) {
+                    return enc.encoded_size(freq->data(), freq->size());
+                }
+            }
+            return enc.encode_size_bound(num);
+        }
+
+        // decode the blocks of a level section, the ones of plan->region_blocks only if a plan is given,
+        // which then gets the unpredictable points of every block
+        void decode_section(uint level, Encoder &section_encoder, Lossless &section_lossless, bool codebook,
+                            uchar const *section, size_t section_size, level_plan *plan = nullptr) {
+            size_t length = section_size;
+            uchar *buffer = section_lossless.decompress(section, length, workspace, level);
+            uchar const *buffer_pos = buffer;
+            if (codebook) {
+                section_encoder.load(buffer_pos, length);
+            }
+            std::vector<size_t> starts = section_blocks(level);
+            size_t num_blocks = 0;
+            read(num_blocks, buffer_pos, length);
+            if (num_blocks + 1 != starts.size()) {
+                throw std::runtime_error("level section has " + std::to_string(num_blocks) + " blocks for " +
+                                         std::to_string(starts.size() - 1));
+            }
+            std::vector<size_t> block_sizes(num_blocks), block_unpred(num_blocks);
+            read(block_sizes.data(), num_blocks, buffer_pos, length);
+            read(block_unpred.data(), num_blocks, buffer_pos, length);
+            with_quant_inds([&](auto *quant) {
+                size_t next = 0;
+                for (size_t b = 0; b < num_blocks; b++) {
+                    // the anchor is always decoded
+                    bool needed = !plan || (level == interpolation_level && b == 0);
+                    if (plan && next < plan->region_blocks.size() && plan->region_blocks[next] == b) {
+                        needed = true;
+                        next++;
+                    }
+                    if (needed) {
+                        uchar const *block_pos = buffer_pos;
+                        section_encoder.decode(block_pos, starts[b + 1] - starts[b], quant + starts[b]);
+                    }
+                    buffer_pos += block_sizes[b];
+                }
+            });
+            if (plan) {
+                plan->block_unpred = std::move(block_unpred);
+            }
+            if (codebook) {
+                section_encoder.postprocess_decode();
+            }
+        }
+
+        // recover the anchor and the levels down to last_level into dec_data
+        void reconstruct(T *dec_data, uint last_level = 1) {
+            double eb = quantizer.get_eb();
+//            quantizer.set_eb(eb * eb_ratio);
+
+//            quantizer.set_eb(eb);
+            Timer timer;
+            timer.start();
+
+            interp_cursor anchor{0, 0, nullptr, nullptr};
+            recover(anchor, *dec_data, 0);
+            size_t quant_count = anchor.quant_pos;
+            size_t unpred_count = anchor.unpred_pos;
+            interpolate_levels<PB_recover>(dec_data, eb, quant_count, unpred_count, last_level);
+            quantizer.postdecompress_data();
+            stats.add_time("Reconstruction", timer.stop());
+            report();
+        }
+
+        // quantization indices take 16 bits when the quantizer radius allows it, which halves their memory
+        void init_quant_inds() {
+            use_quant_inds16 = compact_quant_inds && quantizer.get_radius() <= 32768;
+            if (use_quant_inds16) {
+                std::vector<int>().swap(quant_inds);
+                quant_inds16.resize(num_elements);
+            } else {
+                std::vector<uint16_t>().swap(quant_inds16);
+                quant_inds.resize(num_elements);
+            }
+        }
+
+        // calls func with the pointer to the quantization indices in their storage type
+        template<class Func>
+        inline auto with_quant_inds(Func &&func) {
+            return use_quant_inds16 ? func(quant_inds16.data()) : func(quant_inds.data());
+        }
+
+        inline void store_quant(size_t pos, int quant) {
+            if (use_quant_inds16) {
+                quant_inds16[pos] = quant;
+            } else {
+                quant_inds[pos] = quant;
+            }
+        }
+
+        inline int load_quant(size_t pos) const {
+            return use_quant_inds16 ? quant_inds16[pos] : quant_inds[pos];
+        }
+
+        // position of a worker in the quantization index stream and the unpredictable data
+        struct interp_cursor {
+            size_t quant_pos;
+            size_t unpred_pos; // decompression only
+            std::vector<std::pair<size_t, T>> *unpred; // compression only
+            size_t *freq; // compression only, histogram of the quantization indices
         };
 
-        inline void quantize1(size_t idx, T &d, T pred) {
-            if (idx >= 2 * 449 * 449 * 235 && idx < 3 * 449 * 449 * 235 &&
-                fabs(d - pred) > max_error) {
-                max_error = fabs(d - pred);
+        // the encoder gets the histogram of the indices built while quantizing instead of counting them again
+        static const bool fused_histogram = concepts::has_preprocess_encode_freq<Encoder>::value;
+
+        template<class Q>
+        inline void count_quant(interp_cursor &cursor, const Q *quant, size_t num) {
+            if (fused_histogram) {
+                for (size_t i = 0; i < num; i++) {
+                    cursor.freq[quant[i]]++;
+                }
             }
-            auto quant = quantizer.quantize_and_overwrite(d, pred);
-//            quant_inds.push_back(quant);
-            quant_inds[idx] = quant;
         }
 
-        inline void quantize(size_t idx, T &d, T pred) {
+        size_t *level_freq(int thread, uint level) {
+            return quant_freqs[thread * interpolation_level + level - 1].data();
+        }
+
+        inline int thread_id() const {
+#ifdef _OPENMP
+            return omp_get_thread_num();
+#else
+            return 0;
+#endif
+        }
+
+        inline void quantize(interp_cursor &cursor, T &d, T pred) {
 //            preds[idx] = pred;
-//            quant_inds[idx] = quantizer.quantize_and_overwrite(d, pred);
-            quant_inds.push_back(quantizer.quantize_and_overwrite(d, pred));
+            int quant = quantizer.quantize(d, pred);
+            if (quant) {
+                d = quantizer.recover_pred(pred, quant);
+            } else {
+                cursor.unpred->push_back({cursor.quant_pos, d});
+            }
+            store_quant(cursor.quant_pos++, quant);
+            if (fused_histogram) {
+                cursor.freq[quant]++;
+            }
         }
 
-        inline void recover(T &d, T pred) {
-            d = quantizer.recover(pred, quant_inds[quant_index++]);
+        inline void recover(interp_cursor &cursor, T &d, T pred) {
+            int quant = load_quant(cursor.quant_pos++);
+            if (quant) {
+                d = quantizer.recover_pred(pred, quant);
+            } else {
+                d = quantizer.get_unpred()[cursor.unpred_pos++];
+            }
         };
 
+        void set_level_eb(T eb, uint level) {
+            if (level >= 3) {
+                quantizer.set_eb(eb * eb_ratio);
+            } else {
+                quantizer.set_eb(eb);
+            }
+        }
 
-        double block_interpolation_1d(T *data, size_t begin, size_t end, size_t stride,
-                                      const std::string &interp_func,
-                                      const PredictorBehavior pb) {
-            size_t n = (end - begin) / stride + 1;
-            if (n <= 1) {
-                return 0;
+        // interpolate all levels from the coarsest one, the stream offsets of every level are planned in stream order
+        template<PredictorBehavior pb>
+        void interpolate_levels(T *data, T eb, size_t &quant_count, size_t &unpred_count, uint last_level = 1) {
+            // the interpolators of a level are chosen from its reconstructed coarser levels, which tiles would
+            // only reconstruct afterwards
+            bool choosing = pb == PB_predict_overwrite && adaptive_interpolators;
+            uint tiled = last_level == 1 && !choosing ? tiled_levels() : 0;
+            std::vector<level_plan> plans(tiled + 1);
+            for (uint level = interpolation_level; level >= last_level && level <= interpolation_level; level--) {
+                uint stride = 1U << (level - 1);
+                auto plan = plan_level(stride, quant_count);
+                if (pb == PB_recover) {
+                    plan_unpred(plan, unpred_count);
+                }
+                if (choosing) {
+                    set_level_eb(eb, level);
+                    choose_level_interpolators(data, level);
+                }
+                if (level <= tiled) {
+                    plans[level] = std::move(plan);
+                    continue;
+                }
+                set_level_eb(eb, level);
+                std::vector<size_t> blocks(plan.blocks.size());
+                for (size_t b = 0; b < blocks.size(); b++) {
+                    blocks[b] = b;
+                }
+                for (uint pass = 0; pass < N; pass++) {
+                    interpolation_pass<pb>(data, plan, blocks, pass, stride);
+                }
             }
-            double predict_error = 0;
+            if (tiled) {
+                interpolate_tiles<pb>(data, eb, plans, tiled);
+            }
+        }
 
-            size_t stride3x = 3 * stride;
-            size_t stride5x = 5 * stride;
-            if (interp_func == "linear" || n < 5) {
-                if (pb == PB_predict_overwrite) {
-                    for (size_t i = 1; i + 1 < n; i += 2) {
-                        T *d = data + begin + i * stride;
-                        quantize(d - data, *d, interp_linear(*(d - stride), *(d + stride)));
-                    }
-                    if (n % 2 == 0) {
-                        T *d = data + begin + (n - 1) * stride;
-                        if (n < 4) {
-                            quantize(d - data, *d, *(d - stride));
-                        } else {
-                            quantize(d - data, *d, interp_linear1(*(d - stride3x), *(d - stride)));
+        // number of finest levels whose coarsest block fits in the cache
+        uint tiled_levels() const {
+            uint levels = 0;
+            while (levels < interpolation_level) {
+                size_t bytes = sizeof(T);
+                for (int i = 0; i < N; i++) {
+                    bytes *= (blocksize << levels) + 1;
+                }
+                if (bytes > cache_size) {
+                    break;
+                }
+                levels++;
+            }
+            return levels;
+        }
+
+        // The grid is cut into tiles of one block of the coarsest tiled level, and every tile goes through
+        // all the tiled levels before the next one.
+        // A block only reads points of its own closed box, which belong to its own tile or to earlier tiles
+        // in row-major order, so the results are the same as the level by level sweep.
+        template<PredictorBehavior pb>
+        void interpolate_tiles(T *data, T eb, const std::vector<level_plan> &plans, uint levels) {
+            const level_plan &tiles = plans[levels];
+            std::vector<size_t> blocks;
+            for (size_t t = 0; t < tiles.blocks.size(); t++) {
+                for (uint level = levels; level > 0; level--) {
+                    uint stride = 1U << (level - 1);
+                    const level_plan &plan = plans[level];
+                    // blocks of the level inside the tile, in stream order
+                    std::array<size_t, N> first, last;
+                    for (int i = 0; i < N; i++) {
+                        size_t ratio = 1U << (levels - level);
+                        first[i] = tiles.blocks[t][i] / (blocksize * stride);
+                        last[i] = std::min(first[i] + ratio, plan.block_counts[i]);
+                    }
+                    blocks.clear();
+                    std::array<size_t, N> idx = first;
+                    while (idx[0] < last[0]) {
+                        size_t b = 0;
+                        for (int i = 0; i < N; i++) {
+                            b = b * plan.block_counts[i] + idx[i];
+                        }
+                        blocks.push_back(b);
+                        for (int i = N - 1; i >= 0; i--) {
+                            if (++idx[i] < last[i] || i == 0) {
+                                break;
+                            }
+                            idx[i] = first[i];
                         }
                     }
-                } else {
-                    for (size_t i = 1; i + 1 < n; i += 2) {
-                        T *d = data + begin + i * stride;
-                        recover(*d, interp_linear(*(d - stride), *(d + stride)));
-                    }
-                    if (n % 2 == 0) {
-                        T *d = data + begin + (n - 1) * stride;
-                        if (n < 4) {
-                            recover(*d, *(d - stride));
+                    set_level_eb(eb, level);
+                    for (uint pass = 0; pass < N; pass++) {
+                        interpolation_pass<pb>(data, plan, blocks, pass, stride);
+                    }
+                }
+            }
+        }
+
+        // the blocks of the level in row-major order, the indices of the level start at quant_count
+        level_plan plan_level(uint stride, size_t &quant_count) const {
+            level_plan plan;
+            size_t num_blocks = 1;
+            for (int i = 0; i < N; i++) {
+                plan.block_counts[i] = (global_dimensions[i] - 1) / (blocksize * stride) + 1;
+                num_blocks *= plan.block_counts[i];
+            }
+            plan.blocks.resize(num_blocks);
+            std::array<size_t, N> idx{};
+            for (size_t b = 0; b < num_blocks; b++) {
+                for (int i = 0; i < N; i++) {
+                    plan.blocks[b][i] = idx[i] * blocksize * stride;
+                }
+                for (int i = N - 1; i >= 0; i--) {
+                    if (++idx[i] < plan.block_counts[i]) {
+                        break;
+                    }
+                    idx[i] = 0;
+                }
+            }
+            plan.quant_offsets.resize(plan.blocks.size() * N + 1);
+            for (size_t b = 0; b < plan.blocks.size(); b++) {
+                auto end = block_end(plan.blocks[b], stride);
+                for (uint pass = 0; pass < N; pass++) {
+                    plan.quant_offsets[b * N + pass] = quant_count;
+                    if (pass_active(pass, stride)) {
+                        quant_count += block_pass_size(plan.blocks[b], end, pass, stride);
+                    }
+                }
+            }
+            plan.quant_offsets[plan.blocks.size() * N] = quant_count;
+            return plan;
+        }
+
+        // the unpredictable data of a block pass starts after all the ones stored before it,
+        // so count the unpredictable points (index 0) of every block pass in stream order
+        void plan_unpred(level_plan &plan, size_t &unpred_count) {
+            auto &offsets = plan.unpred_offsets;
+            offsets.resize(plan.blocks.size() * N);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+            for (ptrdiff_t i = 0; i < (ptrdiff_t) offsets.size(); i++) {
+                offsets[i] = with_quant_inds([&](auto *quant) {
+                    return std::count(quant + plan.quant_offsets[i], quant + plan.quant_offsets[i + 1], 0);
+                });
+            }
+            for (auto &offset:offsets) {
+                auto cnt = offset;
+                offset = unpred_count;
+                unpred_count += cnt;
+            }
+        }
+
+        // the unpredictable offsets of the block passes a region needs, the other blocks are counted from
+        // the table of their level section when they were not decoded
+        void plan_region_unpred(level_plan &plan, size_t &unpred_count, uint level) {
+            if (plan.block_unpred.empty()) {
+                plan_unpred(plan, unpred_count);
+                return;
+            }
+            plan.unpred_offsets.resize(plan.blocks.size() * N);
+            size_t next = 0;
+            for (size_t b = 0; b < plan.blocks.size(); b++) {
+                bool needed = next < plan.region_blocks.size() && plan.region_blocks[next] == b;
+                if (needed) {
+                    next++;
+                }
+                if (!needed && !(level == interpolation_level && b == 0)) {
+                    unpred_count += plan.block_unpred[b];
+                    continue;
+                }
+                for (uint pass = 0; pass < N; pass++) {
+                    size_t i = b * N + pass;
+                    plan.unpred_offsets[i] = unpred_count;
+                    unpred_count += with_quant_inds([&](auto *quant) {
+                        return std::count(quant + plan.quant_offsets[i], quant + plan.quant_offsets[i + 1], 0);
+                    });
+                }
+            }
+        }
+
+        // the points of the coarser levels at multiples of step in the buffer of a level, from the buffer of
+        // the level above, whose box holds the one of the level; last is the end of the box of the level
+        void copy_coarse(const T *coarse, const grid_view &coarse_view, T *fine, const grid_view &fine_view,
+                         const std::array<size_t, N> &last, size_t step) const {
+            std::array<size_t, N> x = fine_view.origin;
+            while (true) {
+                size_t src = 0, dst = 0;
+                for (int i = 0; i < N; i++) {
+                    src += ((x[i] - coarse_view.origin[i]) >> coarse_view.shift) * coarse_view.offsets[i];
+                    dst += ((x[i] - fine_view.origin[i]) >> fine_view.shift) * fine_view.offsets[i];
+                }
+                fine[dst] = coarse[src];
+                int i = N - 1;
+                for (; i >= 0; i--) {
+                    x[i] += step;
+                    if (x[i] <= last[i]) {
+                        break;
+                    }
+                    x[i] = fine_view.origin[i];
+                }
+                if (i < 0) {
+                    return;
+                }
+            }
+        }
+
+        std::array<size_t, N> block_end(std::array<size_t, N> begin, uint stride) const {
+            for (int i = 0; i < N; i++) {
+                begin[i] += blocksize * stride;
+                if (begin[i] > global_dimensions[i] - 1) {
+                    begin[i] = global_dimensions[i] - 1;
+                }
+            }
+            return begin;
+        }
+
+        // the dimension of the pass still has points to predict at this stride, it has levels left
+        inline bool pass_active(uint pass, uint stride) const {
+            return __builtin_ctz(stride) < dimension_levels[dimension_sequences[direction_sequence_id][pass]];
+        }
+
+        // number of points predicted by one dimension pass of a block,
+        // each line of n points predicts the n / 2 points in between the ones of the coarser level
+        size_t block_pass_size(const std::array<size_t, N> &begin, const std::array<size_t, N> &end,
+                               uint pass, uint stride) const {
+            const std::array<int, N> &dims = dimension_sequences[direction_sequence_id];
+            size_t size = ((end[dims[pass]] - begin[dims[pass]]) / stride + 1) / 2;
+            for (uint i = 0; i < N; i++) {
+                if (i != pass) {
+                    size_t step = i < pass ? stride : 2 * stride;
+                    size_t start = begin[dims[i]] ? begin[dims[i]] + step : 0;
+                    size *= start > end[dims[i]] ? 0 : (end[dims[i]] - start) / step + 1;
+                }
+            }
+            return size;
+        }
+
+        // the interpolator chosen for the level and dimension of the pass if any, otherwise interpolator_id;
+        // cubic interpolation uses the coefficients fitted for the level and dimension of the pass
+        INTERP_ALGO pass_interpolator(uint pass, uint stride) const {
+            if (!level_interpolators.empty()) {
+                return (INTERP_ALGO) level_interpolators[__builtin_ctz(stride) * N +
+                                                         dimension_sequences[direction_sequence_id][pass]];
+            }
+            auto algo = (INTERP_ALGO) interpolator_id;
+            return algo == INTERP_ALGO_CUBIC ? INTERP_ALGO_CUBIC_P : algo;
+        }
+
+        // Least-squares fit of interp_cubic_p for every level and dimension, on a sample of the input points
+        // at odd positions of the level along the dimension, from their neighbours at distances 1 and 3.
+        // Degenerate samples keep the coefficients of interp_cubic.
+        void fit_cubic_coeffs(const T *data) {
+            cubic_coeffs.clear();
+            level_interpolators.clear();
+            if (interpolator_id != INTERP_ALGO_CUBIC && !adaptive_interpolators) {
+                return;
+            }
+            const size_t max_samples = 8192;
+            cubic_coeffs.assign(interpolation_level * N, std::array<T, 4>{-1.0 / 16, 9.0 / 16, 9.0 / 16, -1.0 / 16});
+            if (adaptive_interpolators) {
+                // chosen level by level at compression, lines too short for a sample keep the interpolator
+                // of the compressor
+                level_interpolators.assign(interpolation_level * N, pass_interpolator(0, 1));
+            }
+            for (uint level = 1; level <= interpolation_level; level++) {
+                size_t stride = 1UL << (level - 1);
+                for (int dim = 0; dim < N; dim++) {
+                    // candidates: odd multiples of stride along dim with 3 strides on both sides,
+                    // any multiple of stride along the other dimensions
+                    std::array<size_t, N> counts;
+                    size_t candidates = 1;
+                    for (int i = 0; i < N; i++) {
+                        if (i == dim) {
+                            counts[i] = global_dimensions[i] > 6 * stride ?
+                                        (global_dimensions[i] - 1 - 6 * stride) / (2 * stride) + 1 : 0;
                         } else {
-                            recover(*d, interp_linear1(*(d - stride3x), *(d - stride)));
+                            counts[i] = (global_dimensions[i] - 1) / stride + 1;
                         }
+                        candidates *= counts[i];
+                    }
+                    if (candidates == 0) {
+                        continue;
+                    }
+                    size_t num_samples = std::min(candidates, max_samples);
+                    double ata[4][5] = {};
+                    size_t samples = 0;
+                    const size_t offset = stride * dimension_offsets[dim];
+                    for (size_t k = 0; k < num_samples; k++) {
+                        // golden ratio sequence over the candidates, a regular step may alias with the grid
+                        size_t c = num_samples == candidates ? k : size_t(fmod(k * 0.6180339887498949, 1.0) *
+                                                                          candidates);
+                        size_t idx = c, pos = 0;
+                        for (int i = N - 1; i >= 0; i--) {
+                            size_t coord = idx % counts[i] * stride * (i == dim ? 2 : 1) + (i == dim ? 3 * stride : 0);
+                            pos += coord * dimension_offsets[i];
+                            idx /= counts[i];
+                        }
+                        const double x[4] = {data[pos - 3 * offset], data[pos - offset], data[pos + offset],
+                                             data[pos + 3 * offset]};
+                        for (int i = 0; i < 4; i++) {
+                            for (int j = 0; j < 4; j++) {
+                                ata[i][j] += x[i] * x[j];
+                            }
+                            ata[i][4] += x[i] * data[pos];
+                        }
+                        samples++;
+                    }
+                    std::array<T, 4> fitted;
+                    if (samples >= 16 && solve_normal_equations(ata, fitted)) {
+                        cubic_coeffs[(level - 1) * N + dim] = fitted;
                     }
                 }
-            } else {
-                if (pb == PB_predict_overwrite) {
+            }
+        }
 
-                    T *d;
-                    size_t i;
-                    for (i = 3; i + 3 < n; i += 2) {
-                        d = data + begin + i * stride;
-                        if (stride!=1){
-                        quantize(d - data, *d,
-                                 interp_cubic(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x)));
-                        }
-                        else{
-                            quantize(d - data, *d,
-                                 interp_cubic_p(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x),c_a,c_b,c_c,c_d ));
+        // Choose the interpolator of every dimension of the level, before its compression, from the entropy of
+        // the quantization indices of a sample of the points its first pass would predict: their neighbours
+        // along the dimension are points of coarser levels, already reconstructed. The interpolator of the
+        // compressor wins ties, which are common on the finest levels where almost all indices are 0.
+        void choose_level_interpolators(const T *data, uint level) {
+            const size_t max_samples = 4096;
+            const size_t stride = 1UL << (level - 1);
+            const double eb = quantizer.get_eb();
+            const int radius = quantizer.get_radius();
+            std::vector<int> quant[3]; // linear, cubic, fitted cubic
+            auto algo = (INTERP_ALGO) interpolator_id;
+            const INTERP_ALGO pass_algo = algo == INTERP_ALGO_CUBIC ? INTERP_ALGO_CUBIC_P : algo;
+            for (int dim = 0; dim < N; dim++) {
+                std::array<size_t, N> counts;
+                size_t candidates = 1;
+                for (int i = 0; i < N; i++) {
+                    if (i == dim) {
+                        counts[i] = global_dimensions[i] > 6 * stride ?
+                                    (global_dimensions[i] - 1 - 6 * stride) / (2 * stride) + 1 : 0;
+                    } else {
+                        counts[i] = (global_dimensions[i] - 1) / (2 * stride) + 1;
+                    }
+                    candidates *= counts[i];
+                }
+                if (candidates < 16) {
+                    continue;
+                }
+                const std::array<T, 4> &fitted = cubic_coeffs[(level - 1) * N + dim];
+                const size_t offset = stride * dimension_offsets[dim];
+                size_t num_samples = std::min(candidates, max_samples);
+                size_t unpred[3] = {};
+                for (auto &q : quant) {
+                    q.clear();
+                }
+                for (size_t k = 0; k < num_samples; k++) {
+                    size_t c = num_samples == candidates ? k : size_t(fmod(k * 0.6180339887498949, 1.0) *
+                                                                      candidates);
+                    size_t idx = c, pos = 0;
+                    for (int i = N - 1; i >= 0; i--) {
+                        size_t coord = idx % counts[i] * 2 * stride + (i == dim ? 3 * stride : 0);
+                        pos += coord * dimension_offsets[i];
+                        idx /= counts[i];
+                    }
+                    const T *d = data + pos;
+                    const double diff[3] = {
+                            *d - interp_linear(*(d - offset), *(d + offset)),
+                            *d - interp_cubic(*(d - 3 * offset), *(d - offset), *(d + offset), *(d + 3 * offset)),
+                            *d - interp_cubic_p(*(d - 3 * offset), *(d - offset), *(d + offset), *(d + 3 * offset),
+                                                fitted[0], fitted[1], fitted[2], fitted[3])
+                    };
+                    for (int i = 0; i < 3; i++) {
+                        double index = fabs(diff[i]) / (2 * eb) + 0.5;
+                        if (index < radius) {
+                            quant[i].push_back(diff[i] < 0 ? -(int) index : (int) index);
+                        } else {
+                            quant[i].push_back(radius);
+                            unpred[i]++;
                         }
                     }
-                    d = data + begin + stride;
-                    quantize(d - data, *d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
+                }
+                const INTERP_ALGO algos[3] = {INTERP_ALGO_LINEAR, INTERP_ALGO_CUBIC, INTERP_ALGO_CUBIC_P};
+                double bits[3];
+                int best = 0;
+                for (int i = 0; i < 3; i++) {
+                    std::sort(quant[i].begin(), quant[i].end());
+                    bits[i] = unpred[i] * sizeof(T) * 8.0;
+                    for (size_t j = 0, l; j < quant[i].size(); j = l) {
+                        for (l = j; l < quant[i].size() && quant[i][l] == quant[i][j]; l++);
+                        bits[i] -= (l - j) * log2((l - j) * 1.0 / quant[i].size());
+                    }
+                    if (algos[i] == pass_algo) {
+                        best = i;
+                    }
+                }
+                for (int i = 0; i < 3; i++) {
+                    if (bits[i] < bits[best]) {
+                        best = i;
+                    }
+                }
+                level_interpolators[(level - 1) * N + dim] = algos[best];
+            }
+        }
 
-                    d = data + begin + i * stride;
-                    quantize(d - data, *d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
-                    if (n % 2 == 0) {
-                        d = data + begin + (n - 1) * stride;
-                        quantize(d - data, *d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
+        // Gaussian elimination with partial pivoting on the augmented 4x4 system, false if it is (nearly) singular
+        static bool solve_normal_equations(double a[4][5], std::array<T, 4> &x) {
+            double scale = 0;
+            for (int i = 0; i < 4; i++) {
+                scale = std::max(scale, fabs(a[i][i]));
+            }
+            for (int col = 0; col < 4; col++) {
+                int pivot = col;
+                for (int row = col + 1; row < 4; row++) {
+                    if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                        pivot = row;
                     }
+                }
+                if (!(fabs(a[pivot][col]) > 1e-12 * scale)) {
+                    return false;
+                }
+                for (int k = 0; k < 5; k++) {
+                    std::swap(a[col][k], a[pivot][k]);
+                }
+                for (int row = col + 1; row < 4; row++) {
+                    double f = a[row][col] / a[col][col];
+                    for (int k = col; k < 5; k++) {
+                        a[row][k] -= f * a[col][k];
+                    }
+                }
+            }
+            double sol[4];
+            for (int row = 3; row >= 0; row--) {
+                double v = a[row][4];
+                for (int k = row + 1; k < 4; k++) {
+                    v -= a[row][k] * sol[k];
+                }
+                sol[row] = v / a[row][row];
+                if (!std::isfinite(sol[row])) {
+                    return false;
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                x[i] = sol[i];
+            }
+            return true;
+        }
 
-                } else {
-                    T *d;
+        // lines of one dimension pass only read points from coarser levels or earlier passes,
+        // so the blocks of a pass are independent of each other
+        template<PredictorBehavior pb>
+        void interpolation_pass(T *data, const level_plan &plan, const std::vector<size_t> &blocks, uint pass,
+                                uint stride) {
+            if (!pass_active(pass, stride)) {
+                // short dimensions drop out of the coarse levels, which refine the long ones only
+                return;
+            }
+            if (!cubic_coeffs.empty()) {
+                // stride is 2^(level - 1)
+                coeffs = cubic_coeffs[__builtin_ctz(stride) * N + dimension_sequences[direction_sequence_id][pass]];
+            }
+            region = region_boxes.empty() ? nullptr : &region_boxes[__builtin_ctz(stride) * N + pass];
+            switch (pass_interpolator(pass, stride)) {
+                case INTERP_ALGO_LINEAR:
+                    return interpolation_pass<INTERP_ALGO_LINEAR, pb>(data, plan, blocks, pass, stride);
+                case INTERP_ALGO_CUBIC:
+                    return interpolation_pass<INTERP_ALGO_CUBIC, pb>(data, plan, blocks, pass, stride);
+                case INTERP_ALGO_CUBIC_P:
+                    return interpolation_pass<INTERP_ALGO_CUBIC_P, pb>(data, plan, blocks, pass, stride);
+                case INTERP_ALGO_AKIMA:
+                    return interpolation_pass<INTERP_ALGO_AKIMA, pb>(data, plan, blocks, pass, stride);
+                case INTERP_ALGO_PCHIP:
+                    return interpolation_pass<INTERP_ALGO_PCHIP, pb>(data, plan, blocks, pass, stride);
+            }
+        }
 
-                    size_t i;
-                    for (i = 3; i + 3 < n; i += 2) {
-                        d = data + begin + i * stride;
-                        if(stride!=1)
-                        recover(*d, interp_cubic(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x)));
-                        else
-                        recover(*d, interp_cubic_p(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x),c_a,c_b,c_c,c_d ));
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        void interpolation_pass(T *data, const level_plan &plan, const std::vector<size_t> &blocks, uint pass,
+                                uint stride) {
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+            for (ptrdiff_t k = 0; k < (ptrdiff_t) blocks.size(); k++) {
+                size_t b = blocks[k];
+                interp_cursor cursor{plan.quant_offsets[b * N + pass], 0, nullptr, nullptr};
+                if (pb == PB_recover) {
+                    cursor.unpred_pos = plan.unpred_offsets[b * N + pass];
+                } else {
+                    cursor.unpred = &unpred_buffers[thread_id()];
+                    if (fused_histogram) {
+                        cursor.freq = level_freq(thread_id(), __builtin_ctz(stride) + 1);
                     }
-                    d = data + begin + stride;
+                }
+                block_interpolation<algo, pb>(data, plan.blocks[b], block_end(plan.blocks[b], stride), pass,
+                                              direction_sequence_id, cursor, stride);
+            }
+        }
 
-                    recover(*d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
+        template<PredictorBehavior pb>
+        inline void predict(interp_cursor &cursor, T &d, T pred) {
+            if (pb == PB_predict_overwrite) {
+                quantize(cursor, d, pred);
+            } else {
+                recover(cursor, d, pred);
+            }
+        }
 
-                    d = data + begin + i * stride;
-                    recover(*d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
+        template<INTERP_ALGO algo>
+        inline T interp_stencil(T a, T b, T c, T d) const {
+            if (algo == INTERP_ALGO_CUBIC_P) {
+                return interp_cubic_p(a, b, c, d, coeffs[0], coeffs[1], coeffs[2], coeffs[3]);
+            }
+            return interp_cubic_family<algo>(a, b, c, d);
+        }
 
-                    if (n % 2 == 0) {
-                        d = data + begin + (n - 1) * stride;
-                        recover(*d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
+        // vector kernels for the interior points of contiguous lines, returns the first point left to the scalar loop
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        inline size_t contiguous_interpolation(T *line, size_t i, size_t n, interp_cursor &cursor) {
+            if constexpr (simd_vector<T>::width > 1 && std::is_same<Quantizer, LinearQuantizer<T>>::value &&
+                          algo != INTERP_ALGO_AKIMA && algo != INTERP_ALGO_PCHIP) {
+                size_t first = i;
+                i = with_quant_inds([&](auto *quant) {
+                    if (pb == PB_predict_overwrite) {
+                        size_t end = simd_interp_quantize<T, algo>(line, i, n, coeffs.data(), quantizer.get_eb(),
+                                                                   quantizer.get_radius(), quant + cursor.quant_pos,
+                                                                   [&](size_t k, T ori) {
+                                                                       cursor.unpred->push_back(
+                                                                               {cursor.quant_pos + k, ori});
+                                                                   });
+                        count_quant(cursor, quant + cursor.quant_pos, (end - first) / 2);
+                        return end;
                     }
+                    const std::vector<T> &unpred = quantizer.get_unpred();
+                    return simd_interp_recover<T, algo>(line, i, n, coeffs.data(), quantizer.get_eb(),
+                                                        quantizer.get_radius(), quant + cursor.quant_pos,
+                                                        [&]() { return unpred[cursor.unpred_pos++]; });
+                });
+                cursor.quant_pos += (i - first) / 2;
+            }
+            return i;
+        }
+
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        double block_interpolation_1d(T *data, size_t begin, size_t end, size_t stride, interp_cursor &cursor) {
+            size_t n = (end - begin) / stride + 1;
+            if (n <= 1) {
+                return 0;
+            }
+            double predict_error = 0;
+
+            size_t stride3x = 3 * stride;
+            size_t stride5x = 5 * stride;
+            if (algo == INTERP_ALGO_LINEAR || n < 5) {
+                size_t i = 1;
+                if (algo == INTERP_ALGO_LINEAR && stride == 1) {
+                    i = contiguous_interpolation<algo, pb>(data + begin, i, n, cursor);
+                }
+                for (; i + 1 < n; i += 2) {
+                    T *d = data + begin + i * stride;
+                    predict<pb>(cursor, *d, interp_linear(*(d - stride), *(d + stride)));
+                }
+                if (n % 2 == 0) {
+                    T *d = data + begin + (n - 1) * stride;
+                    if (n < 4) {
+                        predict<pb>(cursor, *d, *(d - stride));
+                    } else {
+                        predict<pb>(cursor, *d, interp_linear1(*(d - stride3x), *(d - stride)));
+                    }
+                }
+            } else {
+                T *d;
+                size_t i = 3;
+                if (stride == 1) {
+                    i = contiguous_interpolation<algo, pb>(data + begin, i, n, cursor);
+                }
+                for (; i + 3 < n; i += 2) {
+                    d = data + begin + i * stride;
+                    predict<pb>(cursor, *d,
+                                interp_stencil<algo>(*(d - stride3x), *(d - stride), *(d + stride), *(d + stride3x)));
+                }
+                d = data + begin + stride;
+                predict<pb>(cursor, *d, interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x)));
+
+                d = data + begin + i * stride;
+                predict<pb>(cursor, *d, interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride)));
+                if (n % 2 == 0) {
+                    d = data + begin + (n - 1) * stride;
+                    predict<pb>(cursor, *d, interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride)));
                 }
             }
 
             return predict_error;
         }
 
-        template<uint NN = N>
-        typename std::enable_if<NN == 1, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride = 1) {
-            return block_interpolation_1d(data, begin[0], end[0], stride, interp_func, pb);
+        // software prefetch of the points of the next strided line (width elements each),
+        // they sit on different cache lines the hardware prefetcher does not follow
+        inline void prefetch_line(const T *line, size_t n, size_t stride, size_t width) const {
+#if defined(__GNUC__)
+            for (size_t i = 0; i < n; i++) {
+                __builtin_prefetch(line + i * stride);
+                __builtin_prefetch(line + i * stride + width - 1);
+            }
+#endif
         }
 
-        template<uint NN = N>
-        typename std::enable_if<NN == 2, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride = 1) {
+        // count parallel lines of n points with element stride `stride`, whose first points are lane_step apart,
+        // they follow each other in the stream
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        double block_interpolation_lines(T *data, size_t begin, size_t n, size_t stride, size_t count,
+                                         size_t lane_step, interp_cursor &cursor) {
             double predict_error = 0;
-            size_t stride2x = stride * 2;
-            std::array<int, N> dims = dimension_sequences[direction];
-            for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride2x : 0); j <= end[dims[1]]; j += stride2x) {
-                size_t begin_offset = begin[dims[0]] * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]];
-                predict_error += block_interpolation_1d(data, begin_offset,
-                                                        begin_offset +
-                                                        (end[dims[0]] - begin[dims[0]]) * dimension_offsets[dims[0]],
-                                                        stride * dimension_offsets[dims[0]], interp_func, pb);
-            }
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                size_t begin_offset = i * dimension_offsets[dims[0]] + begin[dims[1]] * dimension_offsets[dims[1]];
-                predict_error += block_interpolation_1d(data, begin_offset,
-                                                        begin_offset +
-                                                        (end[dims[1]] - begin[dims[1]]) * dimension_offsets[dims[1]],
-                                                        stride * dimension_offsets[dims[1]], interp_func, pb);
+            size_t line = 0;
+            if (stride != 1 && n > 1) {
+                // lines along the contiguous dimension use the kernels of block_interpolation_1d
+                if (lane_step == 1) {
+                    line = bundle_interpolation<algo, pb, 1>(data + begin, n, stride, count, cursor);
+                } else if (lane_step == 2) {
+                    line = bundle_interpolation<algo, pb, 2>(data + begin, n, stride, count, cursor);
+                }
+            }
+            for (; line < count; line++) {
+                size_t offset = begin + line * lane_step;
+                if (stride != 1 && line + 1 < count) {
+                    prefetch_line(data + offset + lane_step, n, stride, 1);
+                }
+                predict_error += block_interpolation_1d<algo, pb>(data, offset, offset + (n - 1) * stride, stride,
+                                                                  cursor);
             }
             return predict_error;
         }
 
-        template<uint NN = N>
-        typename std::enable_if<NN == 3, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride = 1) {
-            double predict_error = 0;
-            size_t stride2x = stride * 2;
-            std::array<int, N> dims = dimension_sequences[direction];
-            for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride2x : 0); j <= end[dims[1]]; j += stride2x) {
-                for (size_t k = (begin[dims[2]] ? begin[dims[2]] + stride2x : 0); k <= end[dims[2]]; k += stride2x) {
-                    size_t begin_offset = begin[dims[0]] * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]] +
-                                          k * dimension_offsets[dims[2]];
-                    predict_error += block_interpolation_1d(data, begin_offset,
-                                                            begin_offset +
-                                                            (end[dims[0]] - begin[dims[0]]) *
-                                                            dimension_offsets[dims[0]],
-                                                            stride * dimension_offsets[dims[0]], interp_func, pb);
-                }
-            }
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                for (size_t k = (begin[dims[2]] ? begin[dims[2]] + stride2x : 0); k <= end[dims[2]]; k += stride2x) {
-                    size_t begin_offset = i * dimension_offsets[dims[0]] + begin[dims[1]] * dimension_offsets[dims[1]] +
-                                          k * dimension_offsets[dims[2]];
-                    predict_error += block_interpolation_1d(data, begin_offset,
-                                                            begin_offset +
-                                                            (end[dims[1]] - begin[dims[1]]) *
-                                                            dimension_offsets[dims[1]],
-                                                            stride * dimension_offsets[dims[1]], interp_func, pb);
-                }
-            }
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride : 0); j <= end[dims[1]]; j += stride) {
-                    size_t begin_offset = i * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]] +
-                                          begin[dims[2]] * dimension_offsets[dims[2]];
-                    predict_error += block_interpolation_1d(data, begin_offset,
-                                                            begin_offset +
-                                                            (end[dims[2]] - begin[dims[2]]) *
-                                                            dimension_offsets[dims[2]],
-                                                            stride * dimension_offsets[dims[2]], interp_func, pb);
+        // strided lines are interpolated in bundles of adjacent lines, one vector lane per line,
+        // returns the number of lines done
+        template<INTERP_ALGO algo, PredictorBehavior pb, int lane_step>
+        inline size_t bundle_interpolation(T *lines, size_t n, size_t stride, size_t count, interp_cursor &cursor) {
+            size_t line = 0;
+            if constexpr (simd_vector<T>::width > 1 && std::is_same<Quantizer, LinearQuantizer<T>>::value &&
+                          algo != INTERP_ALGO_AKIMA && algo != INTERP_ALGO_PCHIP) {
+                with_quant_inds([&](auto *quant) {
+                    // a line after the bundle keeps the even-lane loads within the data
+                    for (; line + simd_vector<T>::width < count; line += simd_vector<T>::width) {
+                        if (line + 2 * simd_vector<T>::width < count) {
+                            prefetch_line(lines + (line + simd_vector<T>::width) * lane_step, n, stride,
+                                          simd_vector<T>::width * lane_step);
+                        }
+                        bundle_interpolation<algo, pb, lane_step>(lines + line * lane_step, n, stride,
+                                                                  quant + cursor.quant_pos, cursor);
+                    }
+                });
+            }
+            return line;
+        }
+
+        template<INTERP_ALGO algo, PredictorBehavior pb, int lane_step, class Q>
+        void bundle_interpolation(T *lines, size_t n, size_t stride, Q *quant, interp_cursor &cursor) {
+            typedef simd_vector<T> V;
+            const size_t m = n / 2; // points per line
+            const T eb = quantizer.get_eb();
+            const T eb_reciprocal = 1.0 / eb;
+            const int radius = quantizer.get_radius();
+            const std::vector<T> &unpred = quantizer.get_unpred();
+            size_t unpred_pos[V::width];
+            if (pb == PB_recover) {
+                for (int j = 0; j < V::width; j++) {
+                    unpred_pos[j] = cursor.unpred_pos;
+                    cursor.unpred_pos += std::count(quant + j * m, quant + (j + 1) * m, 0);
                 }
             }
-            return predict_error;
+
+            size_t t = 0; // stream position of the point within its line
+            auto predict_lanes = [&](size_t i, typename V::vec pred) {
+                T *p = lines + i * stride;
+                if (pb == PB_predict_overwrite) {
+                    simd_lanes_quantize<T, lane_step>(p, pred, eb, eb_reciprocal, radius, quant + t, m,
+                                                      [&](int j, T ori) {
+                                                          cursor.unpred->push_back({cursor.quant_pos + j * m + t, ori});
+                                                      });
+                } else {
+                    simd_lanes_recover<T, lane_step>(p, pred, eb, radius, quant + t, m,
+                                                     [&](int j) { return unpred[unpred_pos[j]++]; });
+                }
+                t++;
+            };
+            // the few border stencils are evaluated lane by lane
+            T border[V::width];
+            auto border_lanes = [&](size_t i, auto stencil) {
+                for (int j = 0; j < V::width; j++) {
+                    border[j] = stencil(lines + i * stride + j * lane_step);
+                }
+                return V::load(border);
+            };
+
+            size_t stride3x = 3 * stride;
+            size_t stride5x = 5 * stride;
+            if (algo == INTERP_ALGO_LINEAR || n < 5) {
+                size_t i = 1;
+                for (; i + 1 < n; i += 2) {
+                    predict_lanes(i, simd_interp<T, INTERP_ALGO_LINEAR, lane_step>(lines + i * stride, stride,
+                                                                                   coeffs.data()));
+                }
+                if (n % 2 == 0) {
+                    if (n < 4) {
+                        predict_lanes(n - 1, simd_load_lanes<T, lane_step>(lines + (n - 2) * stride));
+                    } else {
+                        predict_lanes(n - 1, border_lanes(n - 1, [&](const T *d) {
+                            return interp_linear1(*(d - stride3x), *(d - stride));
+                        }));
+                    }
+                }
+            } else {
+                size_t i = 3;
+                for (; i + 3 < n; i += 2) {
+                    predict_lanes(i, simd_interp<T, algo, lane_step>(lines + i * stride, stride, coeffs.data()));
+                }
+                predict_lanes(1, border_lanes(1, [&](const T *d) {
+                    return interp_quad_1(*(d - stride), *(d + stride), *(d + stride3x));
+                }));
+                predict_lanes(i, border_lanes(i, [&](const T *d) {
+                    return interp_quad_2(*(d - stride3x), *(d - stride), *(d + stride));
+                }));
+                if (n % 2 == 0) {
+                    predict_lanes(n - 1, border_lanes(n - 1, [&](const T *d) {
+                        return interp_quad_3(*(d - stride5x), *(d - stride3x), *(d - stride));
+                    }));
+                }
+            }
+            if (pb == PB_predict_overwrite) {
+                count_quant(cursor, quant, V::width * m);
+            }
+            cursor.quant_pos += V::width * m;
+        }
+
+        // address in the buffer being interpolated of the coordinate x along dimension dim
+        inline size_t address(int dim, size_t x) const {
+            return ((x - view.origin[dim]) >> view.shift) * view.offsets[dim];
         }
 
+        // loop nest of one dimension pass of a block over the dimensions other than the pass one, outermost first,
+        // with the steps in elements; lines along the innermost loop are handed together to block_interpolation_lines.
+        // Only the iterations [first, last) of every loop are interpolated, the others are skipped in the stream.
+        struct pass_nest {
+            std::array<size_t, N> count;
+            std::array<size_t, N> step;
+            std::array<size_t, N> first;
+            std::array<size_t, N> last;
+            std::array<size_t, N> points; // stream points per iteration
+            size_t n; // points per line
+            size_t line_stride;
+        };
+
+        // moves the cursor over num points of the stream, with their unpredictable data
+        inline void skip_quant(interp_cursor &cursor, size_t num) {
+            if (num) {
+                cursor.unpred_pos += with_quant_inds([&](auto *quant) {
+                    return std::count(quant + cursor.quant_pos, quant + cursor.quant_pos + num, 0);
+                });
+                cursor.quant_pos += num;
+            }
+        }
 
-        template<uint NN = N>
-        typename std::enable_if<NN == 4, double>::type
-        block_interpolation(T *data, std::array<size_t, N> begin, std::array<size_t, N> end, const PredictorBehavior pb,
-                            const std::string &interp_func, const int direction, uint stride = 1) {
+        template<INTERP_ALGO algo, PredictorBehavior pb>
+        double block_interpolation(T *data, const std::array<size_t, N> &begin, const std::array<size_t, N> &end,
+                                   uint pass, const int direction, interp_cursor &cursor, uint stride = 1) {
+            const std::array<int, N> &dims = dimension_sequences[direction];
+            if (region && (end[dims[pass]] < region->lo[dims[pass]] || begin[dims[pass]] > region->hi[dims[pass]])) {
+                return 0;
+            }
+            if (N == 1) {
+                return block_interpolation_1d<algo, pb>(data, address(0, begin[0]), address(0, end[0]),
+                                                        stride >> view.shift, cursor);
+            }
+            // the permutation is resolved once per pass, the loops below only add constant steps
+            pass_nest nest;
+            size_t offset = address(dims[pass], begin[dims[pass]]);
+            for (uint i = 0, d = 0; i < N; i++) {
+                if (i == pass) {
+                    continue;
+                }
+                size_t step = i < pass ? stride : 2 * stride;
+                size_t start = begin[dims[i]] ? begin[dims[i]] + step : 0;
+                if (start > end[dims[i]]) {
+                    return 0;
+                }
+                nest.count[d] = (end[dims[i]] - start) / step + 1;
+                nest.step[d] = (step >> view.shift) * view.offsets[dims[i]];
+                nest.first[d] = 0;
+                nest.last[d] = nest.count[d];
+                if (region) {
+                    size_t lo = region->lo[dims[i]], hi = region->hi[dims[i]];
+                    nest.first[d] = lo > start ? (lo - start - 1) / step + 1 : 0;
+                    nest.last[d] = hi < start ? 0 : std::min(nest.count[d], (hi - start) / step + 1);
+                    if (nest.first[d] >= nest.last[d]) {
+                        return 0;
+                    }
+                }
+                offset += address(dims[i], start);
+                d++;
+            }
+            nest.n = (end[dims[pass]] - begin[dims[pass]]) / stride + 1;
+            nest.line_stride = (stride >> view.shift) * view.offsets[dims[pass]];
+            for (int d = N - 2; d >= 0; d--) {
+                nest.points[d] = d + 2 == N ? nest.n / 2 : nest.points[d + 1] * nest.count[d + 1];
+            }
+            return block_interpolation_loops<algo, pb, 0>(data, nest, offset, cursor);
+        }
+
+        // loop D of the nest, unrolled at compile time down to the innermost one
+        template<INTERP_ALGO algo, PredictorBehavior pb, uint D>
+        inline double block_interpolation_loops(T *data, const pass_nest &nest, size_t offset, interp_cursor &cursor) {
             double predict_error = 0;
-            size_t stride2x = stride * 2;
-            max_error = 0;
-            std::array<int, N> dims = dimension_sequences[direction];
-            for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride2x : 0); j <= end[dims[1]]; j += stride2x) {
-                for (size_t k = (begin[dims[2]] ? begin[dims[2]] + stride2x : 0); k <= end[dims[2]]; k += stride2x) {
-                    for (size_t t = (begin[dims[3]] ? begin[dims[3]] + stride2x : 0);
-                         t <= end[dims[3]]; t += stride2x) {
-                        size_t begin_offset =
-                                begin[dims[0]] * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]] +
-                                k * dimension_offsets[dims[2]] +
-                                t * dimension_offsets[dims[3]];
-                        predict_error += block_interpolation_1d(data, begin_offset,
-                                                                begin_offset +
-                                                                (end[dims[0]] - begin[dims[0]]) *
-                                                                dimension_offsets[dims[0]],
-                                                                stride * dimension_offsets[dims[0]], interp_func, pb);
-                    }
-                }
-            }
-//            printf("%.8f ", max_error);
-            max_error = 0;
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                for (size_t k = (begin[dims[2]] ? begin[dims[2]] + stride2x : 0); k <= end[dims[2]]; k += stride2x) {
-                    for (size_t t = (begin[dims[3]] ? begin[dims[3]] + stride2x : 0);
-                         t <= end[dims[3]]; t += stride2x) {
-                        size_t begin_offset =
-                                i * dimension_offsets[dims[0]] + begin[dims[1]] * dimension_offsets[dims[1]] +
-                                k * dimension_offsets[dims[2]] +
-                                t * dimension_offsets[dims[3]];
-                        predict_error += block_interpolation_1d(data, begin_offset,
-                                                                begin_offset +
-                                                                (end[dims[1]] - begin[dims[1]]) *
-                                                                dimension_offsets[dims[1]],
-                                                                stride * dimension_offsets[dims[1]], interp_func, pb);
-                    }
-                }
-            }
-//            printf("%.8f ", max_error);
-            max_error = 0;
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride : 0); j <= end[dims[1]]; j += stride) {
-                    for (size_t t = (begin[dims[3]] ? begin[dims[3]] + stride2x : 0);
-                         t <= end[dims[3]]; t += stride2x) {
-                        size_t begin_offset = i * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]] +
-                                              begin[dims[2]] * dimension_offsets[dims[2]] +
-                                              t * dimension_offsets[dims[3]];
-                        predict_error += block_interpolation_1d(data, begin_offset,
-                                                                begin_offset +
-                                                                (end[dims[2]] - begin[dims[2]]) *
-                                                                dimension_offsets[dims[2]],
-                                                                stride * dimension_offsets[dims[2]], interp_func, pb);
-                    }
-                }
-            }
-
-//            printf("%.8f ", max_error);
-            max_error = 0;
-            for (size_t i = (begin[dims[0]] ? begin[dims[0]] + stride : 0); i <= end[dims[0]]; i += stride) {
-                for (size_t j = (begin[dims[1]] ? begin[dims[1]] + stride : 0); j <= end[dims[1]]; j += stride) {
-                    for (size_t k = (begin[dims[2]] ? begin[dims[2]] + stride : 0); k <= end[dims[2]]; k += stride) {
-                        size_t begin_offset =
-                                i * dimension_offsets[dims[0]] + j * dimension_offsets[dims[1]] +
-                                k * dimension_offsets[dims[2]] +
-                                begin[dims[3]] * dimension_offsets[dims[3]];
-                        predict_error += block_interpolation_1d(data, begin_offset,
-                                                                begin_offset +
-                                                                (end[dims[3]] - begin[dims[3]]) *
-                                                                dimension_offsets[dims[3]],
-                                                                stride * dimension_offsets[dims[3]], interp_func, pb);
-                    }
-                }
-            }
-//            printf("%.8f \n", max_error);
+            skip_quant(cursor, nest.first[D] * nest.points[D]);
+            offset += nest.first[D] * nest.step[D];
+            if constexpr (D + 2 < N) {
+                for (size_t i = nest.first[D]; i < nest.last[D]; i++, offset += nest.step[D]) {
+                    predict_error += block_interpolation_loops<algo, pb, D + 1>(data, nest, offset, cursor);
+                }
+            } else {
+                predict_error = block_interpolation_lines<algo, pb>(data, offset, nest.n, nest.line_stride,
+                                                                    nest.last[D] - nest.first[D], nest.step[D],
+                                                                    cursor);
+            }
+            skip_quant(cursor, (nest.count[D] - nest.last[D]) * nest.points[D]);
             return predict_error;
         }
 
@@ -529,21 +1873,49 @@ namespace SZ {
         uint blocksize;
         int interpolator_id;
         double eb_ratio = 0.5;
-        std::vector<std::string> interpolators;
         std::vector<int> quant_inds;
-        size_t quant_index = 0; // for decompress
+        std::vector<uint16_t> quant_inds16; // replaces quant_inds when the indices fit in 16 bits
+        bool compact_quant_inds = true;
+        bool use_quant_inds16 = false;
+        bool level_sections = false;
+        bool level_codebooks = false;
+        bool auto_tuning = false;
+        bool adaptive_interpolators = false;
+        bool verbose = false;
+        CompressionStats stats;
+        std::vector<std::vector<std::pair<size_t, T>>> unpred_buffers; // per thread, compression only
+        std::vector<std::vector<size_t>> quant_freqs; // per thread, compression only
 //        std::vector<int> debug;
 //        std::vector<T> preds;
-        double max_error;
+        int num_threads = 1;
+        size_t cache_size = 0;
         Quantizer quantizer;
         Encoder encoder;
+        std::vector<Encoder> level_encoders; // of the level sections with codebooks
         Lossless lossless;
+        std::vector<Lossless> level_lossless; // of the level sections with codebooks, which run in parallel
+        Workspace workspace;
+        OutputArena arena;
         size_t num_elements;
         std::array<size_t, N> global_dimensions;
         std::array<size_t, N> dimension_offsets;
+        std::array<uint, N> dimension_levels; // ceil(log2) of every dimension, interpolation_level is the largest
         std::vector<std::array<int, N>> dimension_sequences;
         int direction_sequence_id;
-        T c_a,c_b,c_c,c_d;
+        // the settings compress starts from
+        struct {
+            Quantizer quantizer;
+            int interpolator;
+            int direction;
+            double eb_ratio;
+        } configured;
+        std::shared_ptr<const InterpolationTuner<T, N>> tuner; // built by the first compression with auto tuning
+        std::vector<std::array<T, 4>> cubic_coeffs; // of interp_cubic_p, for every (level - 1) * N + dimension
+        std::vector<uchar> level_interpolators; // INTERP_ALGO of every (level - 1) * N + dimension, if chosen per level
+        std::array<T, 4> coeffs{}; // of the current pass
+        std::vector<region_box> region_boxes; // points needed after every (level - 1) * N + pass, region decompression only
+        const region_box *region = nullptr; // of the current pass, nullptr for the whole grid
+        grid_view view; // of the buffer being interpolated
     };
 
 
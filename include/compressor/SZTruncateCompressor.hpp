@@ -8,7 +8,9 @@
 #include "utils/FileUtil.h"
 #include "utils/Config.hpp"
 #include "utils/Timer.hpp"
+#include "utils/CompressionStats.hpp"
 #include "utils/ByteUtil.h"
+#include "utils/Workspace.hpp"
 #include "def.hpp"
 #include <cstring>
 
@@ -25,6 +27,8 @@ namespace SZ {
         }
 
         uchar *compress(T *data, size_t &compressed_size) {
+            stats.clear();
+            stats.num_elements = conf.num;
 
             auto compressed_data = new uchar[conf.num * sizeof(T)];
             auto compressed_data_pos = (uint16_t *) compressed_data;
@@ -36,25 +40,33 @@ namespace SZ {
 //                std::cout << std::bitset<32>(data[i]) << " " << std::bitset<16>(*compressed_data_pos) << '\n';
                 compressed_data_pos++;
             }
-            timer.stop("Prediction & Quantization");
+            stats.add_time("Prediction & Quantization", timer.stop());
 
 
             uchar *lossless_data = lossless.compress(compressed_data,
                                                      (uchar *) compressed_data_pos - compressed_data,
                                                      compressed_size);
             lossless.postcompress_data(compressed_data);
+            stats.compressed_bytes = compressed_size;
+            report();
             return lossless_data;
         }
 
 
         T *decompress(uchar const *lossless_compressed_data, const size_t length) {
+            return decompress(lossless_compressed_data, length, new T[conf.num]);
+        }
+
+        T *decompress(uchar const *lossless_compressed_data, const size_t length, T *dec_data) {
             size_t remaining_length = length;
+            stats.clear();
+            stats.num_elements = conf.num;
+            stats.compressed_bytes = length;
 
-            auto compressed_data = lossless.decompress(lossless_compressed_data, remaining_length);
+            auto compressed_data = lossless.decompress(lossless_compressed_data, remaining_length, workspace, 0);
             auto compressed_data_pos = (uint16_t *) compressed_data;
 
             Timer timer(true);
-            auto dec_data = new T[conf.num];
             lfloat bytes;
             bytes.ivalue = 0;
             for (size_t i = 0; i < conf.num; i++) {
@@ -62,15 +74,38 @@ namespace SZ {
                 compressed_data_pos++;
                 dec_data[i] = bytes.value;
             }
-            lossless.postdecompress_data(compressed_data);
-            timer.stop("Prediction & Recover");
+            stats.add_time("Prediction & Recover", timer.stop());
+            report();
             return dec_data;
         }
 
+        // what the last compression or decompression measured
+        const CompressionStats &get_stats() const {
+            return stats;
+        }
+
+        // print the statistics at the end of every call, nothing is printed otherwise
+        void set_verbose(bool print) {
+            verbose = print;
+        }
+
+        bool get_verbose() const {
+            return verbose;
+        }
 
     private:
+        // print the statistics of the last call when asked to
+        void report() const {
+            if (verbose) {
+                stats.print();
+            }
+        }
+
         Lossless lossless;
         Config<T, N> conf;
+        Workspace workspace;
+        CompressionStats stats;
+        bool verbose = false;
     };
 
     template<class T, uint N, class Lossless>
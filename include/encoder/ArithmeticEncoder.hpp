@@ -60,25 +60,39 @@ namespace SZ {
 
 
         void preprocess_encode(const std::vector<T> &bins, int stateNum) {
+            preprocess_encode(bins.data(), bins.size(), stateNum);
+        }
+
+        // the bins may be stored in any integer type holding the states, such as uint16_t
+        template<class Q>
+        void preprocess_encode(const Q *bins, size_t length, int stateNum) {
             assert(stateNum <= 4096 && "StateNum of Arithmetic Encoder should be <= 4096");
             ariCoder.numOfRealStates = stateNum;
-            const T *s = bins.data();
-            size_t length = bins.size();
             if (transform) {
-                bins_transform = bins;
-                for (size_t i = 0; i < bins_transform.size(); i++) {
-                    T x = bins_transform[i];
-                    bins_transform[i] = fabs(x - ariCoder.numOfRealStates / 2) * 2;
-                    if (x - ariCoder.numOfRealStates / 2 < 0) {
-                        bins_transform[i] -= 1;
-                    }
-//                    printf("%d %d\n", bins[i], bins_transform[i]);
-                }
-
-                s = bins_transform.data();
+                transform_bins(bins, length);
+                encode_frequency(bins_transform.data(), length);
+            } else {
+                encode_frequency(bins, length);
             }
+        }
 
+        // fold the states around the center, the encoded bins may be any part of the ones given to preprocess_encode
+        template<class Q>
+        void transform_bins(const Q *bins, size_t length) {
+            bins_transform.assign(bins, bins + length);
+            for (size_t i = 0; i < bins_transform.size(); i++) {
+                T x = bins_transform[i];
+                bins_transform[i] = fabs(x - ariCoder.numOfRealStates / 2) * 2;
+                if (x - ariCoder.numOfRealStates / 2 < 0) {
+                    bins_transform[i] -= 1;
+                }
+//                    printf("%d %d\n", bins[i], bins_transform[i]);
+            }
+        }
 
+        // cumulative frequency of the states
+        template<class Q>
+        void encode_frequency(const Q *s, size_t length) {
             size_t i; //# states is in the range of integer.
             int index = 0;
             size_t *freq = (size_t *) malloc(ariCoder.numOfRealStates * sizeof(size_t));
@@ -467,10 +481,34 @@ namespace SZ {
  * @param size_t *outSize (output)
  *
  * */
+        // the cumulative frequency of a state takes at most 20 bytes
+        size_t save_size_bound() const {
+            return 2 * sizeof(int) + sizeof(uint64_t) + ariCoder.numOfValidStates * 20;
+        }
+
+        // a state takes less than one bit more than the log of the total frequency,
+        // the last codes are stored 4 bytes at a time
+        size_t encode_size_bound(size_t num) const {
+            size_t bits = 64 - __builtin_clzll(ariCoder.total_frequency | 1) + 1;
+            return (num * bits + 7) / 8 + 16;
+        }
+
         //        void ari_encode(AriCoder *ariCoder, int *s, size_t length, unsigned char *out, size_t *outSize) {
         size_t encode(const std::vector<T> &bins, uchar *&bytes) {
-            const T *s = transform ? bins_transform.data() : bins.data();
-            size_t length = transform ? bins_transform.size() : bins.size();
+            return encode(bins.data(), bins.size(), bytes);
+        }
+
+        template<class Q>
+        size_t encode(const Q *bins, size_t length, uchar *&bytes) {
+            if (transform) {
+                transform_bins(bins, length);
+                return encode_states(bins_transform.data(), length, bytes);
+            }
+            return encode_states(bins, length, bytes);
+        }
+
+        template<class Q>
+        size_t encode_states(const Q *s, size_t length, uchar *&bytes) {
 //            unsigned char *bytes = out;
             size_t outSize = 0;
 
@@ -536,6 +574,13 @@ namespace SZ {
  * */
         std::vector<T> decode(const uchar *&bytes, size_t targetLength) {
             std::vector<T> out(targetLength);
+            decode(bytes, targetLength, out.data());
+            return out;
+        }
+
+        // decode into a preallocated buffer of targetLength bins
+        template<class Q>
+        void decode(const uchar *&bytes, size_t targetLength, Q *out) {
 
 //        void ari_decode(AriCoder *ariCoder, unsigned char *s, size_t s_len, size_t targetLength, int *out) {
             size_t high = MAX_CODE;
@@ -598,7 +643,6 @@ namespace SZ {
                 }
             }
             bytes += s_counter;
-            return out;
         }
 
         AriCoder ariCoder;
@@ -12,12 +12,23 @@ namespace SZ {
         ~BypassEncoder() = default;
 
         void preprocess_encode(const std::vector<T> &bins, int stateNum) {
+            preprocess_encode(bins.data(), bins.size(), stateNum);
+        };
+
+        // the bins may be stored in any integer type holding the states, such as uint16_t
+        template<class Q>
+        void preprocess_encode(const Q *bins, size_t num_bin, int stateNum) {
             assert(stateNum <= 256 && "stateNum should be no more than 256.");
         };
 
         size_t encode(const std::vector<T> &bins, uchar *&bytes) {
-            for (auto &bin:bins) {
-                *bytes++ = uchar(bin);
+            return encode(bins.data(), bins.size(), bytes);
+        };
+
+        template<class Q>
+        size_t encode(const Q *bins, size_t num_bin, uchar *&bytes) {
+            for (size_t i = 0; i < num_bin; i++) {
+                *bytes++ = uchar(bins[i]);
             }
             return 0;
         };
@@ -28,18 +39,32 @@ namespace SZ {
 
         std::vector<T> decode(const uchar *&bytes, size_t targetLength) {
             std::vector<T> bins(targetLength);
-            for (auto &bin:bins) {
-                bin = *bytes++;
-            }
+            decode(bytes, targetLength, bins.data());
             return bins;
         };
 
+        // decode into a preallocated buffer of targetLength bins
+        template<class Q>
+        void decode(const uchar *&bytes, size_t targetLength, Q *bins) {
+            for (size_t i = 0; i < targetLength; i++) {
+                bins[i] = *bytes++;
+            }
+        };
+
         void postprocess_decode() {};
 
         uint save(uchar *&c) {
             return 0;
         };
 
+        size_t save_size_bound() const {
+            return 0;
+        }
+
+        size_t encode_size_bound(size_t num) const {
+            return num;
+        }
+
         void load(const uchar *&c, size_t &remaining_length) {};
 
     };
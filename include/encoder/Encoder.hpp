@@ -1,9 +1,35 @@
 #ifndef _SZ_ENCODER_HPP
 #define _SZ_ENCODER_HPP
 
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 namespace SZ {
     namespace concepts {
 
+        // encoders that can build their model from a histogram of the bins,
+        // preprocess_encode_freq(const size_t *freq, size_t num_freq, int stateNum)
+        template<class Encoder, class = void>
+        struct has_preprocess_encode_freq : std::false_type {
+        };
+
+        template<class Encoder>
+        struct has_preprocess_encode_freq<Encoder, std::void_t<decltype(std::declval<Encoder &>().preprocess_encode_freq(
+                std::declval<const size_t *>(), size_t(0), 0))>> : std::true_type {
+        };
+
+        // encoders that can tell how many bytes encode writes for a histogram of the bins once the model is built,
+        // encoded_size(const size_t *freq, size_t num_freq)
+        template<class Encoder, class = void>
+        struct has_encoded_size : std::false_type {
+        };
+
+        template<class Encoder>
+        struct has_encoded_size<Encoder, std::void_t<decltype(std::declval<const Encoder &>().encoded_size(
+                std::declval<const size_t *>(), size_t(0)))>> : std::true_type {
+        };
+
         template<class T>
         class EncoderInterface {
         public:
@@ -24,6 +50,11 @@ namespace SZ {
 
             virtual uint save(uchar *&c) = 0;
 
+            // bytes written at most by save and by encode of num bins, once preprocess_encode has built the model
+            virtual size_t save_size_bound() const = 0;
+
+            virtual size_t encode_size_bound(size_t num) const = 0;
+
             virtual void load(const uchar *&c, size_t &remaining_length) = 0;
 
         };
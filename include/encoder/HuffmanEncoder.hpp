@@ -9,6 +9,9 @@
 #include <cstring>
 #include <cstdio>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <utility>
 
 namespace SZ {
 
@@ -32,7 +35,8 @@ namespace SZ {
             node *qqq, *qq; //the root node of the HuffmanTree is qq[1]
             int n_nodes; //n_nodes is for compression
             int qend;
-            unsigned long **code;
+            unsigned long **code; // code[state] points into codes for the states in use, NULL otherwise
+            unsigned long *codes;
             unsigned char *cout;
             int n_inode; //n_inode is for decompression
             int maxBitCount;
@@ -48,26 +52,61 @@ namespace SZ {
                 sysEndianType = 1;
         }
 
+        // the tree memory is kept from one call to the next and is not shared, copies start without a tree
+        HuffmanEncoder(const HuffmanEncoder &other) : HuffmanEncoder() {}
+
+        // like the copy constructor, the assigned encoder frees its tree and is left without one
+        HuffmanEncoder &operator=(const HuffmanEncoder &other) {
+            if (this != &other) {
+                HuffmanEncoder empty;
+                swap(empty);
+            }
+            return *this;
+        }
+
+        // moves take the tree with the root and node count pointing into it
+        HuffmanEncoder(HuffmanEncoder &&other) noexcept : HuffmanEncoder() {
+            swap(other);
+        }
+
+        HuffmanEncoder &operator=(HuffmanEncoder &&other) noexcept {
+            swap(other);
+            return *this;
+        }
+
         ~HuffmanEncoder() {
             SZ_FreeHuffman();
         }
 
-        //build huffman tree
+        //build huffman tree, reusing the memory of the previous one when it has as many states
         HuffmanTree *createHuffmanTree(int stateNum) {
+            if (huffmanTree != NULL && huffmanTree->stateNum == (unsigned int) stateNum) {
+                // only the nodes of the previous tree and the codes of its leaves were written
+                for (int i = 0; i < huffmanTree->n_nodes; i++) {
+                    if (huffmanTree->pool[i].t) {
+                        huffmanTree->code[huffmanTree->pool[i].c] = NULL;
+                        huffmanTree->cout[huffmanTree->pool[i].c] = 0;
+                    }
+                }
+                memset(huffmanTree->pool, 0, huffmanTree->n_nodes * sizeof(struct node_t));
+                memset(huffmanTree->qqq, 0, std::min(huffmanTree->n_nodes + 1, (int) huffmanTree->allNodes * 2) * sizeof(node));
+                huffmanTree->n_nodes = 0;
+                huffmanTree->n_inode = 0;
+                huffmanTree->qend = 1;
+                return huffmanTree;
+            }
+            SZ_FreeHuffman();
             HuffmanTree *huffmanTree = (HuffmanTree *) malloc(sizeof(HuffmanTree));
             memset(huffmanTree, 0, sizeof(HuffmanTree));
             huffmanTree->stateNum = stateNum;
             huffmanTree->allNodes = 2 * stateNum;
 
-            huffmanTree->pool = (struct node_t *) malloc(huffmanTree->allNodes * 2 * sizeof(struct node_t));
-            huffmanTree->qqq = (node *) malloc(huffmanTree->allNodes * 2 * sizeof(node));
-            huffmanTree->code = (unsigned long **) malloc(huffmanTree->stateNum * sizeof(unsigned long *));
-            huffmanTree->cout = (unsigned char *) malloc(huffmanTree->stateNum * sizeof(unsigned char));
-
-            memset(huffmanTree->pool, 0, huffmanTree->allNodes * 2 * sizeof(struct node_t));
-            memset(huffmanTree->qqq, 0, huffmanTree->allNodes * 2 * sizeof(node));
-            memset(huffmanTree->code, 0, huffmanTree->stateNum * sizeof(unsigned long *));
-            memset(huffmanTree->cout, 0, huffmanTree->stateNum * sizeof(unsigned char));
+            // zeroed pages are only touched by the nodes and codes in use
+            huffmanTree->pool = (struct node_t *) calloc(huffmanTree->allNodes * 2, sizeof(struct node_t));
+            huffmanTree->qqq = (node *) calloc(huffmanTree->allNodes * 2, sizeof(node));
+            huffmanTree->code = (unsigned long **) calloc(huffmanTree->stateNum, sizeof(unsigned long *));
+            huffmanTree->codes = (unsigned long *) calloc(huffmanTree->stateNum * 2, sizeof(unsigned long));
+            huffmanTree->cout = (unsigned char *) calloc(huffmanTree->stateNum, sizeof(unsigned char));
             huffmanTree->qq = huffmanTree->qqq - 1;
             huffmanTree->n_nodes = 0;
             huffmanTree->n_inode = 0;
@@ -80,7 +119,9 @@ namespace SZ {
             preprocess_encode(bins.data(), bins.size(), stateNum);
         }
 
-        void preprocess_encode(const T *bins, size_t num_bin, int stateNum) {
+        // the bins may be stored in any integer type holding the states, such as uint16_t
+        template<class Q>
+        void preprocess_encode(const Q *bins, size_t num_bin, int stateNum) {
             nodeCount = 0;
             huffmanTree = createHuffmanTree(stateNum);
             init(bins, num_bin);
@@ -89,6 +130,47 @@ namespace SZ {
             nodeCount = nodeCount * 2 - 1;
         }
 
+        // build the tree from a histogram of the bins computed by the caller, freq[i] for the states i < num_freq,
+        // which saves a pass over the bins
+        void preprocess_encode_freq(const size_t *freq, size_t num_freq, int stateNum) {
+            nodeCount = 0;
+            huffmanTree = createHuffmanTree(stateNum);
+            init_freq(freq, std::min(num_freq, (size_t) huffmanTree->allNodes));
+            for (int i = 0; i < huffmanTree->stateNum; i++)
+                if (huffmanTree->code[i]) nodeCount++;
+            nodeCount = nodeCount * 2 - 1;
+        }
+
+        //bytes written by encode for bins of histogram freq, plus the slack of its 8-byte stores
+        size_t encoded_size(const size_t *freq, size_t num_freq) const {
+            size_t bits = 0;
+            for (size_t i = 0; i < std::min(num_freq, (size_t) huffmanTree->stateNum); i++) {
+                bits += freq[i] * huffmanTree->cout[i];
+            }
+            return sizeof(size_t) + (bits + 7) / 8 + 16;
+        }
+
+        //bytes written by save, once the tree is built
+        size_t save_size_bound() const {
+            return 2 * sizeof(int) + tree_size(nodeCount);
+        }
+
+        //bytes written at most by encode for num bins, once the tree is built
+        size_t encode_size_bound(size_t num) const {
+            size_t max_bits = 0;
+            for (int i = 0; i < huffmanTree->stateNum; i++) {
+                max_bits = std::max(max_bits, (size_t) huffmanTree->cout[i]);
+            }
+            return sizeof(size_t) + (num * max_bits + 7) / 8 + 16;
+        }
+
+        //bytes written at most by save and encode for num bins of stateNum states, before the tree is built;
+        //codes are at most 128 bits long
+        static size_t size_bound(size_t num, int stateNum) {
+            size_t nodes = 2 * std::min(num, (size_t) stateNum);
+            return 2 * sizeof(int) + tree_size(nodes) + sizeof(size_t) + 16 * num + 16;
+        }
+
         //save the huffman Tree in the compressed data
         uint save(uchar *&c) {
             intToBytes_bigEndian(c, nodeCount);
@@ -114,7 +196,8 @@ namespace SZ {
         }
 
         //perform encoding
-        size_t encode(const T *bins, size_t num_bin, uchar *&bytes) {
+        template<class Q>
+        size_t encode(const Q *bins, size_t num_bin, uchar *&bytes) {
             size_t outSize = 0;
             size_t i = 0;
             unsigned char bitSize = 0, byteSize, byteSizep;
@@ -193,16 +276,23 @@ namespace SZ {
             return outSize;
         }
 
+        // the tree memory is kept for the next tree and released with the encoder
         void postprocess_encode() {
-            SZ_FreeHuffman();
         }
 
         void preprocess_decode() {};
 
         //perform decoding
         std::vector<T> decode(const uchar *&bytes, size_t targetLength) {
-            node t = treeRoot;
             std::vector<T> out(targetLength);
+            decode(bytes, targetLength, out.data());
+            return out;
+        }
+
+        //perform decoding into a preallocated buffer of targetLength bins
+        template<class Q>
+        void decode(const uchar *&bytes, size_t targetLength, Q *out) {
+            node t = treeRoot;
             size_t i = 0, byteIndex = 0, count = 0;
             int r;
             node n = treeRoot;
@@ -212,7 +302,7 @@ namespace SZ {
             {
                 for (count = 0; count < targetLength; count++)
                     out[count] = n->c;
-                return out;
+                return;
             }
 
             for (i = 0; count < targetLength; i++) {
@@ -231,12 +321,10 @@ namespace SZ {
             }
             if (t != n) printf("garbage input\n");
             bytes += encodedLength;
-            return out;
         }
 
-        //empty function
+        // the tree memory is kept for the next tree and released with the encoder
         void postprocess_decode() {
-            SZ_FreeHuffman();
         }
 
         //load Huffman tree
@@ -265,11 +353,24 @@ namespace SZ {
 
     private:
         HuffmanTree *huffmanTree = NULL;
-        node treeRoot;
-        unsigned int nodeCount;
+        node treeRoot = NULL;
+        unsigned int nodeCount = 0;
         uchar sysEndianType; //0: little endian, 1: big endian
         bool loaded = false;
 
+        //bytes of a tree of nodeCount nodes, whose indices take 1, 2 or 4 bytes
+        static size_t tree_size(size_t nodeCount) {
+            size_t index_size = nodeCount <= 256 ? 1 : (nodeCount <= 65536 ? 2 : 4);
+            return 1 + nodeCount * (2 * index_size + 1 + sizeof(T));
+        }
+
+        void swap(HuffmanEncoder &other) noexcept {
+            std::swap(huffmanTree, other.huffmanTree);
+            std::swap(treeRoot, other.treeRoot);
+            std::swap(nodeCount, other.nodeCount);
+            std::swap(loaded, other.loaded);
+        }
+
 
         node reconstruct_HuffTree_from_bytes_anyStates(const unsigned char *bytes, uint nodeCount) {
             if (nodeCount <= 256) {
@@ -457,7 +558,7 @@ namespace SZ {
          * */
         void build_code(node n, int len, unsigned long out1, unsigned long out2) {
             if (n->t) {
-                huffmanTree->code[n->c] = (unsigned long *) malloc(2 * sizeof(unsigned long));
+                huffmanTree->code[n->c] = huffmanTree->codes + 2 * (size_t) n->c;
                 if (len <= 64) {
                     (huffmanTree->code[n->c])[0] = out1 << (64 - len);
                     (huffmanTree->code[n->c])[1] = out2;
@@ -491,7 +592,8 @@ namespace SZ {
          * @param int *s (input)
          * @param size_t length (input)
          * */
-        void init(const T *s, size_t length) {
+        template<class Q>
+        void init(const Q *s, size_t length) {
             size_t i, index;
             size_t *freq = (size_t *) malloc(huffmanTree->allNodes * sizeof(size_t));
             memset(freq, 0, huffmanTree->allNodes * sizeof(size_t));
@@ -499,8 +601,13 @@ namespace SZ {
                 index = s[i];
                 freq[index]++;
             }
+            init_freq(freq, huffmanTree->allNodes);
+            free(freq);
+        }
 
-            for (i = 0; i < huffmanTree->allNodes; i++)
+        // build the Huffman tree from the frequency of the first num_freq states, the others do not occur
+        void init_freq(const size_t *freq, size_t num_freq) {
+            for (size_t i = 0; i < num_freq; i++)
                 if (freq[i])
                     qinsert(new_node(freq[i], i, 0, 0));
 
@@ -509,8 +616,6 @@ namespace SZ {
 
             build_code(huffmanTree->qq[1], 0, 0, 0);
             treeRoot = huffmanTree->qq[1];
-
-            free(freq);
         }
 
         template<class T1>
@@ -582,17 +687,14 @@ namespace SZ {
 
         void SZ_FreeHuffman() {
             if (huffmanTree != NULL) {
-                size_t i;
                 free(huffmanTree->pool);
                 huffmanTree->pool = NULL;
                 free(huffmanTree->qqq);
                 huffmanTree->qqq = NULL;
-                for (i = 0; i < huffmanTree->stateNum; i++) {
-                    if (huffmanTree->code[i] != NULL)
-                        free(huffmanTree->code[i]);
-                }
                 free(huffmanTree->code);
                 huffmanTree->code = NULL;
+                free(huffmanTree->codes);
+                huffmanTree->codes = NULL;
                 free(huffmanTree->cout);
                 huffmanTree->cout = NULL;
                 free(huffmanTree);
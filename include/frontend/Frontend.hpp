@@ -18,8 +18,14 @@ namespace SZ {
 
             virtual T *decompress(std::vector<int> &quant_inds) = 0;
 
+            // into dec_data of get_num_elements() elements, returns dec_data
+            virtual T *decompress(std::vector<int> &quant_inds, T *dec_data) = 0;
+
             virtual void save(uchar *&c) = 0;
 
+            // bytes written at most by save
+            virtual size_t save_size_bound() const = 0;
+
             virtual void load(const uchar *&c, size_t &remaining_length) = 0;
 
             virtual int get_radius() const = 0;
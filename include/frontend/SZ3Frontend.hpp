@@ -31,97 +31,85 @@ namespace SZ {
 
         std::vector<int> compress(T *data) {
             std::vector<int> quant_inds(num_elements);
-            auto inter_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions),
-                                                                                         stride, 0);
-            auto intra_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions), 1,
-                                                                                         0);
+            SZ::multi_dimensional_range<T, N> inter_block_range(data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), stride, 0);
+            SZ::multi_dimensional_range<T, N> intra_block_range(data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), 1, 0);
             std::array<size_t, N> intra_block_dims;
-            predictor.precompress_data(inter_block_range->begin());
+            predictor.precompress_data(inter_block_range.begin());
             quantizer.precompress_data();
             size_t quant_count = 0;
             struct timespec start, end;
-            auto inter_begin = inter_block_range->begin();
-            auto inter_end = inter_block_range->end();
+            auto inter_begin = inter_block_range.begin();
+            auto inter_end = inter_block_range.end();
             for (auto block = inter_begin; block != inter_end; ++block) {
 
                 // std::cout << *block << " " << lp.predict(block) << std::endl;
                 for (int i = 0; i < intra_block_dims.size(); i++) {
                     size_t cur_index = block.get_local_index(i);
-                    size_t dims = inter_block_range->get_dimensions(i);
+                    size_t dims = inter_block_range.get_dimensions(i);
                     intra_block_dims[i] = (cur_index == dims - 1 &&
                                            global_dimensions[i] - cur_index * stride < block_size) ?
                                           global_dimensions[i] - cur_index * stride : block_size;
                 }
 
-                intra_block_range->set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
-                intra_block_range->set_offsets(block.get_offset());
-                intra_block_range->set_starting_position(block.get_local_index());
-                concepts::PredictorInterface<T, N> *predictor_withfallback = &predictor;
-                if (!predictor.precompress_block(intra_block_range)) {
-                    predictor_withfallback = &fallback_predictor;
+                intra_block_range.set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
+                intra_block_range.set_offsets(block.get_offset());
+                intra_block_range.set_starting_position(block.get_local_index());
+                if (predictor.precompress_block(intra_block_range)) {
+                    predictor.precompress_block_commit();
+                    quantize_block(predictor, intra_block_range, quant_inds.data() + quant_count);
+                } else {
+                    fallback_predictor.precompress_block_commit();
+                    quantize_block(fallback_predictor, intra_block_range, quant_inds.data() + quant_count);
                 }
-                predictor_withfallback->precompress_block_commit();
 //                    quantizer.precompress_block();
-                auto intra_begin = intra_block_range->begin();
-                auto intra_end = intra_block_range->end();
-                for (auto element = intra_begin; element != intra_end; ++element) {
-                    quant_inds[quant_count++] = quantizer.quantize_and_overwrite(
-                            *element, predictor_withfallback->predict(element));
-                }
+                quant_count += intra_block_range.size();
             }
 
-            predictor.postcompress_data(inter_block_range->begin());
+            predictor.postcompress_data(inter_block_range.begin());
             quantizer.postcompress_data();
             return quant_inds;
         }
 
         T *decompress(std::vector<int> &quant_inds) {
+            return decompress(quant_inds, new T[num_elements]);
+        }
+
+        T *decompress(std::vector<int> &quant_inds, T *dec_data) {
 
             int const *quant_inds_pos = (int const *) quant_inds.data();
             std::array<size_t, N> intra_block_dims;
-            auto dec_data = new T[num_elements];
-            auto inter_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(dec_data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions),
-                                                                                         block_size,
-                                                                                         0);
-
-            auto intra_block_range = std::make_shared<SZ::multi_dimensional_range<T, N>>(dec_data,
-                                                                                         std::begin(global_dimensions),
-                                                                                         std::end(global_dimensions), 1,
-                                                                                         0);
-
-            predictor.predecompress_data(inter_block_range->begin());
+            SZ::multi_dimensional_range<T, N> inter_block_range(dec_data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), block_size, 0);
+
+            SZ::multi_dimensional_range<T, N> intra_block_range(dec_data, std::begin(global_dimensions),
+                                                                std::end(global_dimensions), 1, 0);
+
+            predictor.predecompress_data(inter_block_range.begin());
             quantizer.predecompress_data();
 
-            auto inter_begin = inter_block_range->begin();
-            auto inter_end = inter_block_range->end();
+            auto inter_begin = inter_block_range.begin();
+            auto inter_end = inter_block_range.end();
             for (auto block = inter_begin; block != inter_end; block++) {
                 for (int i = 0; i < intra_block_dims.size(); i++) {
                     size_t cur_index = block.get_local_index(i);
-                    size_t dims = inter_block_range->get_dimensions(i);
+                    size_t dims = inter_block_range.get_dimensions(i);
                     intra_block_dims[i] = (cur_index == dims - 1) ? global_dimensions[i] - cur_index * block_size
                                                                   : block_size;
                 }
-                intra_block_range->set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
-                intra_block_range->set_offsets(block.get_offset());
-                intra_block_range->set_starting_position(block.get_local_index());
-
-                concepts::PredictorInterface<T, N> *predictor_withfallback = &predictor;
-                if (!predictor.predecompress_block(intra_block_range)) {
-                    predictor_withfallback = &fallback_predictor;
-                }
-                auto intra_begin = intra_block_range->begin();
-                auto intra_end = intra_block_range->end();
-                for (auto element = intra_begin; element != intra_end; ++element) {
-                    *element = quantizer.recover(predictor_withfallback->predict(element), *(quant_inds_pos++));
+                intra_block_range.set_dimensions(intra_block_dims.begin(), intra_block_dims.end());
+                intra_block_range.set_offsets(block.get_offset());
+                intra_block_range.set_starting_position(block.get_local_index());
+
+                if (predictor.predecompress_block(intra_block_range)) {
+                    recover_block(predictor, intra_block_range, quant_inds_pos);
+                } else {
+                    recover_block(fallback_predictor, intra_block_range, quant_inds_pos);
                 }
+                quant_inds_pos += intra_block_range.size();
             }
-            predictor.postdecompress_data(inter_block_range->begin());
+            predictor.postdecompress_data(inter_block_range.begin());
             quantizer.postdecompress_data();
             return dec_data;
         }
@@ -134,14 +122,17 @@ namespace SZ {
             quantizer.save(c);
         }
 
+        size_t save_size_bound() const {
+            return N * sizeof(size_t) + sizeof(block_size) + predictor.save_size_bound() +
+                   quantizer.save_size_bound();
+        }
+
         void load(const uchar *&c, size_t &remaining_length) {
             read(global_dimensions.data(), N, c, remaining_length);
             num_elements = 1;
             for (const auto &d : global_dimensions) {
                 num_elements *= d;
-                std::cout << d << " ";
             }
-            std::cout << std::endl;
             read(block_size, c, remaining_length);
             stride = block_size;
             predictor.load(c, remaining_length);
@@ -164,6 +155,24 @@ namespace SZ {
         size_t get_num_elements() const { return num_elements; };
 
     private:
+        // the element loops are made for the predictor of the block, whose predict is called without
+        // virtual dispatch so that it can be inlined
+        template<class P>
+        void quantize_block(P &block_predictor, multi_dimensional_range<T, N> &range, int *quant_pos) {
+            auto range_end = range.end();
+            for (auto element = range.begin(); element != range_end; ++element) {
+                *(quant_pos++) = quantizer.quantize_and_overwrite(*element, block_predictor.P::predict(element));
+            }
+        }
+
+        template<class P>
+        void recover_block(P &block_predictor, multi_dimensional_range<T, N> &range, int const *quant_pos) {
+            auto range_end = range.end();
+            for (auto element = range.begin(); element != range_end; ++element) {
+                *element = quantizer.recover(block_predictor.P::predict(element), *(quant_pos++));
+            }
+        }
+
         Predictor predictor;
         LorenzoPredictor<T, N, 1> fallback_predictor;
         Quantizer quantizer;
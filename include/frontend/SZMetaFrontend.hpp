@@ -37,7 +37,11 @@ namespace SZ {
         };
 
         T *decompress(std::vector<int> &quant_inds) {
-            return decompress_3d(quant_inds);
+            return decompress_3d(quant_inds, (T *) malloc(size.num_elements * sizeof(T)));
+        };
+
+        T *decompress(std::vector<int> &quant_inds, T *dec_data) {
+            return decompress_3d(quant_inds, dec_data);
         };
 
 
@@ -77,6 +81,19 @@ namespace SZ {
             quantizer.save(c);
         }
 
+        // the regression coefficients are coded with the node count and tree size ahead of the tree
+        size_t save_size_bound() const {
+            size_t bound = sizeof(params) + sizeof(precision) + sizeof(mean_info) + sizeof(reg_count) +
+                           HuffmanEncoder<int>::size_bound(indicator.size(), SELECTOR_RADIUS) +
+                           quantizer.save_size_bound();
+            if (reg_count) {
+                bound += sizeof(size_t) + (reg_unpredictable_data_pos - reg_unpredictable_data) * sizeof(float) +
+                         2 * sizeof(size_t) + HuffmanEncoder<int>::size_bound(RegCoeffNum3d * reg_count,
+                                                                              2 * RegCoeffCapacity);
+            }
+            return bound;
+        }
+
         void load(const uchar *&c, size_t &remaining_length) {
             clear();
             const uchar *c_pos = c;
@@ -322,10 +339,9 @@ namespace SZ {
 
         //T *
 //        meta_decompress_3d(const unsigned char *compressed, size_t r1, size_t r2, size_t r3) {
-        T *decompress_3d(std::vector<int> &quant_inds) {
+        T *decompress_3d(std::vector<int> &quant_inds, T *dec_data) {
 
             int *type = quant_inds.data();
-            T *dec_data = (T *) malloc(size.num_elements * sizeof(T));
 //    dec_data_sp_float = (float *) dec_data;
             const float *reg_params_pos = (const float *) (reg_params + RegCoeffNum3d);;
 
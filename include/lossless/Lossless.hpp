@@ -5,6 +5,8 @@
 #ifndef SZ_LOSSLESS_HPP
 #define SZ_LOSSLESS_HPP
 
+#include "utils/Workspace.hpp"
+#include "utils/OutputArena.hpp"
 
 namespace SZ {
     namespace concepts {
@@ -17,7 +19,16 @@ namespace SZ {
 
             virtual uchar *compress(uchar *data, size_t dataLength, size_t &outSize) = 0;
 
+            // compress the chunks of the arena as one input into a new[] buffer owned by the caller
+            virtual uchar *compress(const OutputArena &data, size_t &outSize) = 0;
+
+            // the same with the first prefix bytes of the buffer left to the caller, outSize counts them
+            virtual uchar *compress(const OutputArena &data, size_t &outSize, size_t prefix) = 0;
+
             virtual uchar *decompress(const uchar *data, size_t& compressedSize) = 0;
+
+            // decompress into buffer i of the workspace, or not at all, there is nothing to release
+            virtual uchar *decompress(const uchar *data, size_t &compressedSize, Workspace &workspace, size_t i) = 0;
         };
     }
 }
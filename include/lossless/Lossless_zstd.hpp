@@ -5,26 +5,81 @@
 #ifndef SZ_LOSSLESS_ZSTD_HPP
 #define SZ_LOSSLESS_ZSTD_HPP
 
+#define ZSTD_STATIC_LINKING_ONLY // ZSTD_initCStream_srcSize
 #include "zstd.h"
 #include "def.hpp"
 #include "utils/MemoryUtil.hpp"
 #include "utils/FileUtil.h"
 #include "lossless/Lossless.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace SZ {
     class Lossless_zstd : public concepts::LosslessInterface {
 
     public:
+        Lossless_zstd() = default;
+
+        // the contexts are kept from one call to the next and are not shared, copies start without them
+        Lossless_zstd(const Lossless_zstd &) {}
+
+        Lossless_zstd &operator=(const Lossless_zstd &) {
+            return *this;
+        }
+
+        Lossless_zstd(Lossless_zstd &&other) noexcept {
+            std::swap(cctx, other.cctx);
+            std::swap(dctx, other.dctx);
+        }
+
+        Lossless_zstd &operator=(Lossless_zstd &&other) noexcept {
+            std::swap(cctx, other.cctx);
+            std::swap(dctx, other.dctx);
+            return *this;
+        }
+
+        ~Lossless_zstd() {
+            ZSTD_freeCCtx(cctx);
+            ZSTD_freeDCtx(dctx);
+        }
+
         uchar *compress(uchar *data, size_t dataLength, size_t &outSize) {
-            size_t estimatedCompressedSize = dataLength < 100 ? 200 : dataLength * 1.2;
-            uchar *compressBytes = new uchar[estimatedCompressedSize];
-            uchar *compressBytesPos = compressBytes;
+            return compress(data, dataLength, outSize, 0);
+        }
+
+        uchar *compress(const OutputArena &data, size_t &outSize) {
+            return compress(data, outSize, 0);
+        }
+
+        uchar *compress(const OutputArena &data, size_t &outSize, size_t prefix) {
+            auto &chunks = data.get_chunks();
+            if (data.used_chunks() == 1) {
+                return compress(chunks[0].data.get(), chunks[0].size, outSize, prefix);
+            }
+            size_t dataLength = data.size();
+            size_t estimatedCompressedSize = ZSTD_compressBound(dataLength);
+            std::unique_ptr<uchar[]> compressBytes(new uchar[prefix + sizeof(size_t) + estimatedCompressedSize]);
+            uchar *compressBytesPos = compressBytes.get() + prefix;
             write(dataLength, compressBytesPos);
 
-            outSize = ZSTD_compress(compressBytesPos, estimatedCompressedSize, data, dataLength,
-                                    3); //default setting of level is 3
-            outSize += sizeof(size_t);
-            return compressBytes;
+            // the frame records the content size like a one-shot compression
+            ZSTD_CStream *stream = compression_context();
+            check(ZSTD_initCStream_srcSize(stream, 3, dataLength));
+            ZSTD_outBuffer out = {compressBytesPos, estimatedCompressedSize, 0};
+            for (size_t i = 0; i < data.used_chunks(); i++) {
+                ZSTD_inBuffer in = {chunks[i].data.get(), chunks[i].size, 0};
+                while (in.pos < in.size) {
+                    check(ZSTD_compressStream(stream, &out, &in));
+                    check_room(out);
+                }
+            }
+            while (check(ZSTD_endStream(stream, &out)) != 0) {
+                check_room(out);
+            }
+            outSize = prefix + sizeof(size_t) + out.pos;
+            return compressBytes.release();
         }
 
         void postcompress_data(uchar *data) {
@@ -36,16 +91,73 @@ namespace SZ {
             size_t dataLength = 0;
             read(dataLength, dataPos, compressedSize);
 
-            uchar *oriData = new uchar[dataLength];
-            ZSTD_decompress(oriData, dataLength, dataPos, compressedSize);
+            std::unique_ptr<uchar[]> oriData(new uchar[dataLength]);
+            check(ZSTD_decompressDCtx(decompression_context(), oriData.get(), dataLength, dataPos, compressedSize));
             compressedSize = dataLength;
-            return oriData;
+            return oriData.release();
         }
 
         void postdecompress_data(uchar *data) {
             delete[] data;
         }
 
+        uchar *decompress(const uchar *data, size_t &compressedSize, Workspace &workspace, size_t i) {
+            const uchar *dataPos = data;
+            size_t dataLength = 0;
+            read(dataLength, dataPos, compressedSize);
+
+            uchar *oriData = workspace.bytes(dataLength, i);
+            check(ZSTD_decompressDCtx(decompression_context(), oriData, dataLength, dataPos, compressedSize));
+            compressedSize = dataLength;
+            return oriData;
+        }
+
+    private:
+        // one-shot compression after prefix bytes left to the caller
+        uchar *compress(uchar *data, size_t dataLength, size_t &outSize, size_t prefix) {
+            // small incompressible inputs grow by more than 20%
+            size_t estimatedCompressedSize = ZSTD_compressBound(dataLength);
+            std::unique_ptr<uchar[]> compressBytes(new uchar[prefix + sizeof(size_t) + estimatedCompressedSize]);
+            uchar *compressBytesPos = compressBytes.get() + prefix;
+            write(dataLength, compressBytesPos);
+
+            outSize = check(ZSTD_compressCCtx(compression_context(), compressBytesPos, estimatedCompressedSize, data,
+                                              dataLength, 3)); //default setting of level is 3
+            outSize += prefix + sizeof(size_t);
+            return compressBytes.release();
+        }
+
+        // a zstd error code is not a size, stop on it
+        static size_t check(size_t code) {
+            if (ZSTD_isError(code)) {
+                throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(code));
+            }
+            return code;
+        }
+
+        // the output is sized with ZSTD_compressBound, a stream that fills it would never end
+        static void check_room(const ZSTD_outBuffer &out) {
+            if (out.pos == out.size) {
+                throw std::runtime_error("zstd: output buffer full");
+            }
+        }
+
+        ZSTD_CCtx *compression_context() {
+            if (cctx == nullptr) {
+                cctx = ZSTD_createCCtx();
+            }
+            return cctx;
+        }
+
+        ZSTD_DCtx *decompression_context() {
+            if (dctx == nullptr) {
+                dctx = ZSTD_createDCtx();
+            }
+            return dctx;
+        }
+
+        ZSTD_CCtx *cctx = nullptr;
+        ZSTD_DCtx *dctx = nullptr;
     };
 }
 #endif //SZ_LOSSLESS_ZSTD_HPP
\ No newline at end of file
@@ -42,15 +42,15 @@ namespace SZ {
         }
 
 
-        bool precompress_block(const std::shared_ptr<Range> &range) {
+        bool precompress_block(Range &range) {
             std::vector<bool> precompress_block_result;
             for (const auto &p:predictors) {
                 precompress_block_result.push_back(p->precompress_block(range));
             }
-            const auto &dims = range->get_dimensions();
+            const auto &dims = range.get_dimensions();
             int min_dimension = *std::min_element(dims.begin(), dims.end());
 
-            do_estimate_error(range->begin(), min_dimension);
+            do_estimate_error(range.begin(), min_dimension);
 
             sid = std::distance(predict_error.begin(), std::min_element(predict_error.begin(), predict_error.end()));
             // std::cout << sid << std::endl;
@@ -62,7 +62,7 @@ namespace SZ {
             predictors[sid]->precompress_block_commit();
         }
 
-        bool predecompress_block(const std::shared_ptr<Range> &range) {
+        bool predecompress_block(Range &range) {
             sid = selection[current_index++];
             return predictors[sid]->predecompress_block(range);
         }
@@ -92,6 +92,17 @@ namespace SZ {
             // std::cout << "selection size: " << selection.size() << std::endl;
         }
 
+        size_t save_size_bound() const {
+            size_t bound = sizeof(size_t);
+            for (const auto &p:predictors) {
+                bound += p->save_size_bound();
+            }
+            if (selection.size()) {
+                bound += HuffmanEncoder<int>::size_bound(selection.size(), 4 * predictors.size());
+            }
+            return bound;
+        }
+
         void load(const uchar *&c, size_t &remaining_length) {
             auto tmp = c;
             for (const auto &p:predictors) {
@@ -104,6 +115,8 @@ namespace SZ {
             // TODO: check correctness
             size_t selection_size = *reinterpret_cast<const size_t *>(c);
             c += sizeof(size_t);
+            selection.clear();
+            current_index = 0;
             if (selection_size > 0) {
                 remaining_length -= sizeof(size_t);
                 HuffmanEncoder<int> selection_encoder;
@@ -179,6 +192,16 @@ namespace SZ {
                 pred->clear();
             }
             selection.clear();
+            current_index = 0;
+        }
+
+        // a copy of a ComposedPredictor shares its predictors, a clone has clones of them
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            auto copy = std::make_shared<ComposedPredictor>(*this);
+            for (auto &pred:copy->predictors) {
+                pred = pred->clone();
+            }
+            return copy;
         }
 
     private:
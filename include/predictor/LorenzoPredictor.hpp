@@ -5,6 +5,7 @@
 #include "predictor/Predictor.hpp"
 #include "utils/Iterator.hpp"
 #include <cassert>
+#include <memory>
 
 namespace SZ {
 
@@ -51,11 +52,11 @@ namespace SZ {
 
         void postdecompress_data(const iterator &) const {}
 
-        bool precompress_block(const std::shared_ptr<Range> &) { return true; }
+        bool precompress_block(Range &) { return true; }
 
         void precompress_block_commit() noexcept {}
 
-        bool predecompress_block(const std::shared_ptr<Range> &) { return true; }
+        bool predecompress_block(Range &) { return true; }
 
         /*
          * save doesn't need to store anything except the id
@@ -69,6 +70,10 @@ namespace SZ {
             c += sizeof(uint8_t);
         }
 
+        size_t save_size_bound() const {
+            return sizeof(uint8_t);
+        }
+
         /*
          * just verifies the ID, increments
          */
@@ -92,65 +97,90 @@ namespace SZ {
             return fabs(*iter - predict(iter)) + this->noise;
         }
 
+        // points with all their neighbors in the range skip the bound checks of prev
         inline T predict(const iterator &iter) const noexcept {
-            return do_predict(iter);
+            if (iter.interior(L)) {
+                return do_predict<true>(iter);
+            }
+            return do_predict<false>(iter);
         }
 
         void clear() {}
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<LorenzoPredictor>(*this);
+        }
+
     protected:
         T noise = 0;
 
     private:
-        template<uint NN = N, uint LL = L>
+        template<bool interior, class... Args>
+        static inline T prev(const iterator &iter, Args &&... pos) noexcept {
+            if constexpr (interior) {
+                return iter.prev_interior(std::forward<Args>(pos)...);
+            } else {
+                return iter.prev(std::forward<Args>(pos)...);
+            }
+        }
+
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 1 && LL == 1, T>::type do_predict(const iterator &iter) const noexcept {
-            return iter.prev(1);
+            return prev<interior>(iter, 1);
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 2 && LL == 1, T>::type do_predict(const iterator &iter) const noexcept {
-            return iter.prev(0, 1) + iter.prev(1, 0) - iter.prev(1, 1);
+            return prev<interior>(iter, 0, 1) + prev<interior>(iter, 1, 0) - prev<interior>(iter, 1, 1);
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 3 && LL == 1, T>::type do_predict(const iterator &iter) const noexcept {
-            return iter.prev(0, 0, 1) + iter.prev(0, 1, 0) + iter.prev(1, 0, 0)
-                   - iter.prev(0, 1, 1) - iter.prev(1, 0, 1) - iter.prev(1, 1, 0)
-                   + iter.prev(1, 1, 1);
+            return prev<interior>(iter, 0, 0, 1) + prev<interior>(iter, 0, 1, 0) + prev<interior>(iter, 1, 0, 0)
+                   - prev<interior>(iter, 0, 1, 1) - prev<interior>(iter, 1, 0, 1) - prev<interior>(iter, 1, 1, 0)
+                   + prev<interior>(iter, 1, 1, 1);
 
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 4, T>::type do_predict(const iterator &iter) const noexcept {
-            return iter.prev(0, 0, 0, 1) + iter.prev(0, 0, 1, 0) - iter.prev(0, 0, 1, 1) + iter.prev(0, 1, 0, 0)
-                   - iter.prev(0, 1, 0, 1) - iter.prev(0, 1, 1, 0) + iter.prev(0, 1, 1, 1) + iter.prev(1, 0, 0, 0)
-                   - iter.prev(1, 0, 0, 1) - iter.prev(1, 0, 1, 0) + iter.prev(1, 0, 1, 1) - iter.prev(1, 1, 0, 0)
-                   + iter.prev(1, 1, 0, 1) + iter.prev(1, 1, 1, 0) - iter.prev(1, 1, 1, 1);
+            return prev<interior>(iter, 0, 0, 0, 1) + prev<interior>(iter, 0, 0, 1, 0)
+                   - prev<interior>(iter, 0, 0, 1, 1) + prev<interior>(iter, 0, 1, 0, 0)
+                   - prev<interior>(iter, 0, 1, 0, 1) - prev<interior>(iter, 0, 1, 1, 0)
+                   + prev<interior>(iter, 0, 1, 1, 1) + prev<interior>(iter, 1, 0, 0, 0)
+                   - prev<interior>(iter, 1, 0, 0, 1) - prev<interior>(iter, 1, 0, 1, 0)
+                   + prev<interior>(iter, 1, 0, 1, 1) - prev<interior>(iter, 1, 1, 0, 0)
+                   + prev<interior>(iter, 1, 1, 0, 1) + prev<interior>(iter, 1, 1, 1, 0)
+                   - prev<interior>(iter, 1, 1, 1, 1);
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 1 && LL == 2, T>::type do_predict(const iterator &iter) const noexcept {
-            return 2 * iter.prev(1) - iter.prev(2);
+            return 2 * prev<interior>(iter, 1) - prev<interior>(iter, 2);
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 2 && LL == 2, T>::type do_predict(const iterator &iter) const noexcept {
-            return 2 * iter.prev(0, 1) - iter.prev(0, 2) + 2 * iter.prev(1, 0)
-                   - 4 * iter.prev(1, 1) + 2 * iter.prev(1, 2) - iter.prev(2, 0)
-                   + 2 * iter.prev(2, 1) - iter.prev(2, 2);
+            return 2 * prev<interior>(iter, 0, 1) - prev<interior>(iter, 0, 2) + 2 * prev<interior>(iter, 1, 0)
+                   - 4 * prev<interior>(iter, 1, 1) + 2 * prev<interior>(iter, 1, 2) - prev<interior>(iter, 2, 0)
+                   + 2 * prev<interior>(iter, 2, 1) - prev<interior>(iter, 2, 2);
         }
 
-        template<uint NN = N, uint LL = L>
+        template<bool interior, uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 3 && LL == 2, T>::type do_predict(const iterator &iter) const noexcept {
-            return 2 * iter.prev(0, 0, 1) - iter.prev(0, 0, 2) + 2 * iter.prev(0, 1, 0)
-                   - 4 * iter.prev(0, 1, 1) + 2 * iter.prev(0, 1, 2) - iter.prev(0, 2, 0)
-                   + 2 * iter.prev(0, 2, 1) - iter.prev(0, 2, 2) + 2 * iter.prev(1, 0, 0)
-                   - 4 * iter.prev(1, 0, 1) + 2 * iter.prev(1, 0, 2) - 4 * iter.prev(1, 1, 0)
-                   + 8 * iter.prev(1, 1, 1) - 4 * iter.prev(1, 1, 2) + 2 * iter.prev(1, 2, 0)
-                   - 4 * iter.prev(1, 2, 1) + 2 * iter.prev(1, 2, 2) - iter.prev(2, 0, 0)
-                   + 2 * iter.prev(2, 0, 1) - iter.prev(2, 0, 2) + 2 * iter.prev(2, 1, 0)
-                   - 4 * iter.prev(2, 1, 1) + 2 * iter.prev(2, 1, 2) - iter.prev(2, 2, 0)
-                   + 2 * iter.prev(2, 2, 1) - iter.prev(2, 2, 2);
+            return 2 * prev<interior>(iter, 0, 0, 1) - prev<interior>(iter, 0, 0, 2)
+                   + 2 * prev<interior>(iter, 0, 1, 0) - 4 * prev<interior>(iter, 0, 1, 1)
+                   + 2 * prev<interior>(iter, 0, 1, 2) - prev<interior>(iter, 0, 2, 0)
+                   + 2 * prev<interior>(iter, 0, 2, 1) - prev<interior>(iter, 0, 2, 2)
+                   + 2 * prev<interior>(iter, 1, 0, 0) - 4 * prev<interior>(iter, 1, 0, 1)
+                   + 2 * prev<interior>(iter, 1, 0, 2) - 4 * prev<interior>(iter, 1, 1, 0)
+                   + 8 * prev<interior>(iter, 1, 1, 1) - 4 * prev<interior>(iter, 1, 1, 2)
+                   + 2 * prev<interior>(iter, 1, 2, 0) - 4 * prev<interior>(iter, 1, 2, 1)
+                   + 2 * prev<interior>(iter, 1, 2, 2) - prev<interior>(iter, 2, 0, 0)
+                   + 2 * prev<interior>(iter, 2, 0, 1) - prev<interior>(iter, 2, 0, 2)
+                   + 2 * prev<interior>(iter, 2, 1, 0) - 4 * prev<interior>(iter, 2, 1, 1)
+                   + 2 * prev<interior>(iter, 2, 1, 2) - prev<interior>(iter, 2, 2, 0)
+                   + 2 * prev<interior>(iter, 2, 2, 1) - prev<interior>(iter, 2, 2, 2);
         };
     };
 }
@@ -3,6 +3,7 @@
 
 #include "utils/Iterator.hpp"
 #include "def.hpp"
+#include <memory>
 
 namespace SZ {
 
@@ -25,14 +26,17 @@ namespace SZ {
 
             virtual void postdecompress_data(const iterator &) const = 0;
 
-            virtual bool precompress_block(const std::shared_ptr<Range> &) = 0;
+            virtual bool precompress_block(Range &) = 0;
 
             virtual void precompress_block_commit() = 0;
 
-            virtual bool predecompress_block(const std::shared_ptr<Range> &) = 0;
+            virtual bool predecompress_block(Range &) = 0;
 
             virtual void save(uchar *&c) const = 0;
 
+            // bytes written at most by save
+            virtual size_t save_size_bound() const = 0;
+
             virtual void load(const uchar *&c, size_t &remaining_length) = 0;
 
             virtual T predict(const iterator &iter) const noexcept = 0;
@@ -42,6 +46,9 @@ namespace SZ {
             virtual void print() const = 0;
 
             virtual void clear() = 0;
+
+            // a copy that shares no state with this predictor, for a compressor working on another thread
+            virtual std::shared_ptr<PredictorInterface> clone() const = 0;
         };
 
         /**
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <iostream>
 #include <fstream>
+#include <memory>
 
 namespace SZ {
 
@@ -45,9 +46,9 @@ namespace SZ {
             return fabs(*iter - predict(iter));
         }
 
-        bool precompress_block(const std::shared_ptr<Range> &range) noexcept {
+        bool precompress_block(Range &range) noexcept {
             // std::cout << "precompress_block" << std::endl;
-            auto dims = range->get_dimensions();
+            auto dims = range.get_dimensions();
             size_t num_elements = 1;
             for (const auto &dim : dims) {
                 num_elements *= dim;
@@ -60,16 +61,21 @@ namespace SZ {
             std::array<double, N + 1> sum{0};
 
             {
-                auto range_begin = range->begin();
-                auto range_end = range->end();
+                auto range_begin = range.begin();
+                auto range_end = range.end();
+                // rows along the last dimension are read through a pointer, the iterator only jumps to their ends
+                std::array<int, N> row_end{0};
+                row_end[N - 1] = dims[N - 1] - 1;
+                size_t row_stride = range_begin.row_stride();
                 for (auto iter = range_begin; iter != range_end; ++iter) {
                     double sum_cumulative = 0;
-                    for (int t = 0; t < dims[N - 1]; t++) {
-                        T data = *iter;
+                    const T *row = iter.data();
+                    for (size_t t = 0; t < dims[N - 1]; t++) {
+                        T data = row[t * row_stride];
                         sum_cumulative += data;
-                        sum[N - 1] += iter.get_local_index(N - 1) * data;
-                        iter.move();
+                        sum[N - 1] += t * data;
                     }
+                    iter.move2(row_end);
                     for (int i = 0; i < N - 1; i++) {
                         sum[i] += sum_cumulative * iter.get_local_index(i);
                     }
@@ -120,8 +126,18 @@ namespace SZ {
             }
         }
 
-        bool predecompress_block(const std::shared_ptr<Range> &range) noexcept {
-            for (const auto &dim :  range->get_dimensions()) {
+        size_t save_size_bound() const {
+            size_t bound = sizeof(uint8_t) + sizeof(size_t);
+            if (!regression_coeff_quant_inds.empty()) {
+                bound += quantizer_independent.save_size_bound() + quantizer_liner.save_size_bound() +
+                         HuffmanEncoder<int>::size_bound(regression_coeff_quant_inds.size(), 4 * std::max(
+                                 quantizer_liner.get_radius(), quantizer_independent.get_radius()));
+            }
+            return bound;
+        }
+
+        bool predecompress_block(Range &range) noexcept {
+            for (const auto &dim :  range.get_dimensions()) {
                 if (dim <= 1) {
                     return false;
                 }
@@ -132,7 +148,6 @@ namespace SZ {
 
         void load(const uchar *&c, size_t &remaining_length) {
             //TODO: adjust remaining_length
-            std::cout << "load regression predictor" << std::endl;
             c += sizeof(uint8_t);
             remaining_length -= sizeof(uint8_t);
 
@@ -178,6 +193,10 @@ namespace SZ {
             prev_coeffs = {0};
         }
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<RegressionPredictor>(*this);
+        }
+
         std::array<T, N + 1> get_current_coeffs() {
             return current_coeffs;
         }
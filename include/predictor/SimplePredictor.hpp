@@ -5,6 +5,7 @@
 #include "predictor/Predictor.hpp"
 #include "utils/Iterator.hpp"
 #include <cassert>
+#include <memory>
 
 namespace SZ {
 
@@ -33,11 +34,11 @@ namespace SZ {
 
         void postdecompress_data(const iterator &) const {}
 
-        bool precompress_block(const std::shared_ptr<Range> &) { return true; }
+        bool precompress_block(Range &) { return true; }
 
         void precompress_block_commit() noexcept {}
 
-        bool predecompress_block(const std::shared_ptr<Range> &) { return true; }
+        bool predecompress_block(Range &) { return true; }
 
         /*
          * save doesn't need to store anything except the id
@@ -51,6 +52,10 @@ namespace SZ {
             c += sizeof(uint8_t);
         }
 
+        size_t save_size_bound() const {
+            return sizeof(uint8_t);
+        }
+
         /*
          * just verifies the ID, increments
          */
@@ -80,6 +85,10 @@ namespace SZ {
 
         void clear() {}
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<SimplePredictor>(*this);
+        }
+
     protected:
         T noise = 0;
 
@@ -132,6 +132,11 @@ namespace SZ {
             return unpred[index++];
         }
 
+        // record an unpredictable value, for callers that quantize without overwriting
+        void insert_unpred(T ori) {
+            unpred.push_back(ori);
+        }
+
         void save(unsigned char *&c) const {
             // std::string serialized(sizeof(uint8_t) + sizeof(T) + sizeof(int),0);
             c[0] = 0b00000010;
@@ -147,6 +152,10 @@ namespace SZ {
             c += unpred.size() * sizeof(T);
         };
 
+        size_t save_size_bound() const {
+            return sizeof(uint8_t) + sizeof(T) + sizeof(int) + sizeof(size_t) + unpred.size() * sizeof(T);
+        }
+
         void load(const unsigned char *&c, size_t &remaining_length) {
             assert(remaining_length > (sizeof(uint8_t) + sizeof(T) + sizeof(int)));
             c += sizeof(uint8_t);
@@ -170,6 +179,16 @@ namespace SZ {
             index = 0;
         }
 
+        // unpredictable data in stream order, for callers that recover them out of order
+        const std::vector<T> &get_unpred() const {
+            return unpred;
+        }
+
+        void set_unpred(std::vector<T> &&data) {
+            unpred = std::move(data);
+            index = 0;
+        }
+
         virtual void postcompress_data() {
         }
 
@@ -21,6 +21,9 @@ namespace SZ {
 
             virtual void save(uchar *&c) const = 0;
 
+            // bytes written at most by save
+            virtual size_t save_size_bound() const = 0;
+
             virtual void load(const uchar *&c, size_t &remaining_length) = 0;
 
             virtual int quantize(T data, T pred) = 0;
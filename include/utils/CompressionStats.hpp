@@ -0,0 +1,90 @@
+#ifndef SZ_COMPRESSION_STATS_HPP
+#define SZ_COMPRESSION_STATS_HPP
+
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SZ {
+
+    // What a compressor measured during its last compression or decompression.
+    // It is filled whether or not it is printed, the fields a compressor does not know are left empty.
+    struct CompressionStats {
+        size_t num_elements = 0;
+        double error_bound = 0;
+        size_t unpredictable = 0; // values stored as they are
+        size_t compressed_bytes = 0;
+        std::vector<std::pair<std::string, double>> times; // seconds of every stage, in order
+        std::vector<double> level_entropy; // bits per quantization index of every level, from the finest one
+        std::vector<size_t> section_bytes; // compressed header then level sections from the coarsest one
+        std::vector<double> selection; // share of the blocks given to every predictor
+
+        void clear() {
+            num_elements = 0;
+            error_bound = 0;
+            unpredictable = 0;
+            compressed_bytes = 0;
+            times.clear();
+            level_entropy.clear();
+            section_bytes.clear();
+            selection.clear();
+        }
+
+        void add_time(const char *stage, double seconds) {
+            times.emplace_back(stage, seconds);
+        }
+
+        double time(const std::string &stage) const {
+            for (const auto &t : times) {
+                if (t.first == stage) {
+                    return t.second;
+                }
+            }
+            return 0;
+        }
+
+        // entropy in bits per index of a histogram
+        static double entropy(const size_t *freq, size_t num_freq) {
+            size_t total = 0;
+            for (size_t i = 0; i < num_freq; i++) {
+                total += freq[i];
+            }
+            double bits = 0;
+            for (size_t i = 0; i < num_freq; i++) {
+                if (freq[i]) {
+                    double p = freq[i] * 1.0 / total;
+                    bits -= p * log2(p);
+                }
+            }
+            return bits;
+        }
+
+        void print(FILE *out = stdout) const {
+            fprintf(out, "elements = %zu, error bound = %g, unpredictable = %zu", num_elements, error_bound,
+                    unpredictable);
+            if (compressed_bytes) {
+                fprintf(out, ", compressed bytes = %zu", compressed_bytes);
+            }
+            fprintf(out, "\n");
+            for (const auto &t : times) {
+                fprintf(out, "%s time = %fs\n", t.first.c_str(), t.second);
+            }
+            for (size_t l = 0; l < level_entropy.size(); l++) {
+                fprintf(out, "level %zu entropy = %.3f bits\n", l + 1, level_entropy[l]);
+            }
+            for (size_t s = 0; s < section_bytes.size(); s++) {
+                if (s == 0) {
+                    fprintf(out, "header bytes = %zu\n", section_bytes[s]);
+                } else {
+                    fprintf(out, "level %zu section bytes = %zu\n", section_bytes.size() - s, section_bytes[s]);
+                }
+            }
+            for (size_t p = 0; p < selection.size(); p++) {
+                fprintf(out, "predictor %zu blocks = %.3f\n", p, selection[p]);
+            }
+        }
+    };
+}
+#endif
@@ -0,0 +1,205 @@
+#ifndef SZ_INTERPOLATION_TUNER_HPP
+#define SZ_INTERPOLATION_TUNER_HPP
+
+#include "def.hpp"
+#include "utils/Interpolators.hpp"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace SZ {
+
+    // Picks the interpolator, the dimension sequence and the eb_ratio of SZInterpolationCompressor
+    // from the entropy of the quantization indices of a sample of points of every level,
+    // instead of compressing the data with every candidate.
+    // The neighbours of a point are the original values plus the error of the level they are reconstructed at,
+    // so a smaller eb_ratio costs more bits on the coarse levels and saves some on the fine ones.
+    template<class T, uint N>
+    class InterpolationTuner {
+    public:
+        struct choice {
+            int interpolator;
+            int direction;
+            double eb_ratio;
+            double bits; // estimated size of the quantization indices
+        };
+
+        InterpolationTuner(const std::array<size_t, N> &dims, const std::vector<std::array<int, N>> &sequences,
+                           uint levels, size_t samples_per_level = 1024) :
+                dims(dims), sequences(sequences), levels(levels) {
+            offsets[N - 1] = 1;
+            for (int i = N - 2; i >= 0; i--) {
+                offsets[i] = offsets[i + 1] * dims[i + 1];
+            }
+            uint64_t state = 0x9e3779b97f4a7c15ULL;
+            samples.resize(levels + 1);
+            level_points.assign(levels + 1, 0);
+            for (uint level = 1; level <= levels; level++) {
+                size_t stride = 1UL << (level - 1);
+                level_points[level] = grid_points(stride) - grid_points(2 * stride);
+                if (level_points[level] == 0) {
+                    continue;
+                }
+                size_t num = std::min(samples_per_level, level_points[level]);
+                // points of the level have an odd multiple of the stride along at least one dimension
+                for (size_t k = 0, tries = 0; k < num && tries < 64 * num; tries++) {
+                    sample s{0, {}, 0};
+                    for (int i = 0; i < N; i++) {
+                        size_t m = next_random(state) % ((dims[i] - 1) / stride + 1);
+                        s.coord[i] = m * stride;
+                        s.offset += s.coord[i] * offsets[i];
+                        if (m % 2) {
+                            s.odd |= 1U << i;
+                        }
+                    }
+                    if (s.odd) {
+                        samples[level].push_back(s);
+                        k++;
+                    }
+                }
+            }
+        }
+
+        // interpolators then eb_ratios with the first sequence, then the sequences with the best pair.
+        // When the compressor chooses the interpolator of every level, its coarse levels cost fewer bits than
+        // estimated here, so an eb_ratio of 1 is left out: it saves bits on the coarse levels at the expense
+        // of the fine ones, which hold most of the points
+        choice tune(const T *data, double eb, int radius, bool level_interpolators = false) const {
+            choice best{INTERP_ALGO_LINEAR, 0, 0.5, 0};
+            bool first = true;
+            for (int interpolator : {INTERP_ALGO_LINEAR, INTERP_ALGO_CUBIC}) {
+                for (double eb_ratio : {1.0, 0.5, 0.25}) {
+                    if (level_interpolators && eb_ratio == 1.0) {
+                        continue;
+                    }
+                    double bits = estimate(data, eb, radius, interpolator, 0, eb_ratio);
+                    if (first || bits < best.bits) {
+                        best = {interpolator, 0, eb_ratio, bits};
+                        first = false;
+                    }
+                }
+            }
+            for (int direction = 1; direction < (int) sequences.size(); direction++) {
+                double bits = estimate(data, eb, radius, best.interpolator, direction, best.eb_ratio);
+                if (bits < best.bits) {
+                    best.direction = direction;
+                    best.bits = bits;
+                }
+            }
+            return best;
+        }
+
+        // estimated bits of the quantization indices and the unpredictable data
+        double estimate(const T *data, double eb, int radius, int interpolator, int direction,
+                        double eb_ratio) const {
+            const std::array<int, N> &sequence = sequences[direction];
+            double bits = 0;
+            std::vector<int> quant;
+            for (uint level = 1; level <= levels; level++) {
+                if (samples[level].empty()) {
+                    continue;
+                }
+                size_t stride = 1UL << (level - 1);
+                double level_eb = level_error_bound(level, eb, eb_ratio);
+                size_t unpred = 0;
+                quant.clear();
+                for (const auto &s : samples[level]) {
+                    // the point is predicted by the pass of its odd dimension that comes last in the sequence
+                    int dim = 0;
+                    for (int i = 0; i < N; i++) {
+                        if (s.odd & (1U << sequence[i])) {
+                            dim = sequence[i];
+                        }
+                    }
+                    T pred = predict(data, s, dim, stride, interpolator, eb, eb_ratio);
+                    double diff = data[s.offset] - pred;
+                    size_t index = (size_t) (fabs(diff) / level_eb) + 1;
+                    if (index < 2 * (size_t) radius) {
+                        int half = index >> 1;
+                        quant.push_back(diff < 0 ? -half : half);
+                    } else {
+                        quant.push_back(radius);
+                        unpred++;
+                    }
+                }
+                std::sort(quant.begin(), quant.end());
+                double entropy = 0;
+                for (size_t i = 0, j; i < quant.size(); i = j) {
+                    for (j = i; j < quant.size() && quant[j] == quant[i]; j++);
+                    double p = (j - i) * 1.0 / quant.size();
+                    entropy -= p * log2(p);
+                }
+                double scale = level_points[level] * 1.0 / quant.size();
+                bits += scale * (quant.size() * entropy + unpred * sizeof(T) * 8.0);
+            }
+            return bits;
+        }
+
+    private:
+        struct sample {
+            size_t offset;
+            std::array<size_t, N> coord;
+            uint odd; // dimensions with an odd multiple of the stride
+        };
+
+        static uint64_t next_random(uint64_t &state) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        size_t grid_points(size_t stride) const {
+            size_t points = 1;
+            for (int i = 0; i < N; i++) {
+                points *= (dims[i] - 1) / stride + 1;
+            }
+            return points;
+        }
+
+        double level_error_bound(uint level, double eb, double eb_ratio) const {
+            return level >= 3 ? eb * eb_ratio : eb;
+        }
+
+        // the neighbour at distance k * stride along dim, with the error of the level it is reconstructed at
+        T neighbour(const T *data, const sample &s, int dim, ptrdiff_t k, size_t stride, double eb,
+                    double eb_ratio) const {
+            size_t c = s.coord[dim] + k * (ptrdiff_t) stride;
+            uint level = levels;
+            for (int i = 0; i < N; i++) {
+                size_t coord = i == dim ? c : s.coord[i];
+                if (coord) {
+                    level = std::min(level, (uint) __builtin_ctzl(coord) + 1);
+                }
+            }
+            size_t offset = s.offset + (c - s.coord[dim]) * offsets[dim];
+            uint64_t hash = offset;
+            double noise = (next_random(hash) >> 11) * (2.0 / 9007199254740992.0) - 1;
+            return data[offset] + noise * level_error_bound(level, eb, eb_ratio);
+        }
+
+        // the stencils of the line interior, linear on the borders
+        T predict(const T *data, const sample &s, int dim, size_t stride, int interpolator, double eb,
+                  double eb_ratio) const {
+            size_t c = s.coord[dim];
+            auto at = [&](ptrdiff_t k) { return neighbour(data, s, dim, k, stride, eb, eb_ratio); };
+            if (c + stride >= dims[dim]) {
+                return c >= 3 * stride ? interp_linear1(at(-3), at(-1)) : at(-1);
+            }
+            if (interpolator == INTERP_ALGO_LINEAR || c < 3 * stride || c + 3 * stride >= dims[dim]) {
+                return interp_linear(at(-1), at(1));
+            }
+            return interp_cubic(at(-3), at(-1), at(1), at(3));
+        }
+
+        std::array<size_t, N> dims;
+        std::array<size_t, N> offsets;
+        std::vector<std::array<int, N>> sequences;
+        uint levels;
+        std::vector<std::vector<sample>> samples; // of every level
+        std::vector<size_t> level_points;
+    };
+}
+#endif
@@ -5,7 +5,14 @@
 #ifndef SZ_INTERPOLATORS_HPP
 #define SZ_INTERPOLATORS_HPP
 
+#include <cmath>
+
 namespace SZ {
+    // interpolator ids, the cubic family shares the quadratic stencils on the line borders
+    enum INTERP_ALGO {
+        INTERP_ALGO_LINEAR, INTERP_ALGO_CUBIC, INTERP_ALGO_CUBIC_P, INTERP_ALGO_AKIMA, INTERP_ALGO_PCHIP
+    };
+
     template<class T>
     inline T interp_linear(T a, T b) {
         return (a + b) / 2;
@@ -84,12 +91,23 @@ namespace SZ {
     inline T interp_pchip(T a, T b, T c, T d) {
         T pchip = (b + c) / 2;
         if ((b - a < 0) == (c - b < 0) && fabs(c - a) > 1e-9) {
-            pchip += 1 / 4 * (b - a) * (c - b) / (c - a);
+            pchip += (b - a) * (c - b) / (c - a) / 4;
         }
         if ((c - b < 0) == (d - c < 0) && fabs(d - b) > 1e-9) {
-            pchip -= 1 / 4 * (c - b) * (d - c) / (d - b);
+            pchip -= (c - b) * (d - c) / (d - b) / 4;
         }
         return pchip;
     }
+
+    // interior stencil of the cubic family, the fitted interp_cubic_p needs its coefficients from the caller
+    template<INTERP_ALGO algo, class T>
+    inline T interp_cubic_family(T a, T b, T c, T d) {
+        if (algo == INTERP_ALGO_AKIMA) {
+            return interp_akima(a, b, c, d);
+        } else if (algo == INTERP_ALGO_PCHIP) {
+            return interp_pchip(a, b, c, d);
+        }
+        return interp_cubic(a, b, c, d);
+    }
 }
 #endif //SZ_INTERPOLATORS_HPP
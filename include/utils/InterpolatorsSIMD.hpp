@@ -0,0 +1,397 @@
+#ifndef SZ_INTERPOLATORS_SIMD_HPP
+#define SZ_INTERPOLATORS_SIMD_HPP
+
+#include "utils/Interpolators.hpp"
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace SZ {
+    // Vector kernels for interpolation lines.
+    // On lines with element stride 1, the points to predict sit at odd offsets and all their neighbours at even offsets,
+    // so width of them are predicted together from even-lane loads and quantized as one vector.
+    // Strided lines are processed in bundles of width adjacent parallel lines instead, one lane per line.
+    // The arithmetic follows interp_linear/interp_cubic/interp_cubic_p and LinearQuantizer operation by operation,
+    // without FMA, so the results are bit-identical to the scalar path (build with -ffp-contract=off).
+    // The kernels are enabled at compile time by -mavx2 or -mavx512f.
+
+    template<class T>
+    struct simd_vector {
+        static const int width = 1; // no vector kernel
+    };
+
+#if defined(__AVX512F__)
+
+    template<>
+    struct simd_vector<float> {
+        typedef __m512 vec;
+        static const int width = 16;
+
+        static inline vec load_even(const float *p) {
+            const __m512i idx = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+            return _mm512_permutex2var_ps(_mm512_loadu_ps(p), idx, _mm512_loadu_ps(p + 16));
+        }
+
+        static inline vec load(const float *p) { return _mm512_loadu_ps(p); }
+
+        static inline vec set1(float v) { return _mm512_set1_ps(v); }
+
+        static inline vec add(vec a, vec b) { return _mm512_add_ps(a, b); }
+
+        static inline vec sub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+
+        static inline vec mul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+
+        // LinearQuantizer::quantize on every lane, returns the mask of unpredictable lanes
+        static inline uint32_t quantize(vec x, vec pred, float eb, float eb_reciprocal, int radius,
+                                        int *quant, float *dec) {
+            vec diff = _mm512_sub_ps(x, pred);
+            vec abs_diff = _mm512_abs_ps(diff);
+            // the scalar quantizer scales |diff| in double precision
+            const __m512d scale = _mm512_set1_pd(eb_reciprocal);
+            const __m512d limit = _mm512_set1_pd(2.0 * radius);
+            __m512d lo = _mm512_min_pd(_mm512_mul_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(abs_diff)), scale), limit);
+            __m512d hi = _mm512_min_pd(_mm512_mul_pd(_mm512_cvtps_pd(_mm256_castpd_ps(
+                    _mm512_extractf64x4_pd(_mm512_castps_pd(abs_diff), 1))), scale), limit);
+            __m512i qi = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)),
+                                            _mm512_cvttpd_epi32(hi), 1);
+            qi = _mm512_add_epi32(qi, _mm512_set1_epi32(1));
+            __mmask16 valid = _mm512_cmplt_epi32_mask(qi, _mm512_set1_epi32(2 * radius));
+            __m512i half = _mm512_srai_epi32(qi, 1);
+            __m512i q2 = _mm512_slli_epi32(half, 1);
+            __mmask16 neg = _mm512_cmp_ps_mask(diff, _mm512_setzero_ps(), _CMP_LT_OQ);
+            q2 = _mm512_mask_sub_epi32(q2, neg, _mm512_setzero_si512(), q2);
+            vec d = _mm512_add_ps(pred, _mm512_mul_ps(_mm512_cvtepi32_ps(q2), _mm512_set1_ps(eb)));
+            __mmask16 ok = valid & _mm512_cmp_ps_mask(_mm512_abs_ps(_mm512_sub_ps(d, x)), _mm512_set1_ps(eb),
+                                                      _CMP_NGT_UQ);
+            const __m512i r = _mm512_set1_epi32(radius);
+            __m512i q = _mm512_mask_sub_epi32(_mm512_add_epi32(r, half), neg, r, half);
+            _mm512_storeu_si512(quant, _mm512_maskz_mov_epi32(ok, q));
+            _mm512_storeu_ps(dec, _mm512_mask_blend_ps(ok, x, d));
+            return (uint32_t) (~ok & 0xffff);
+        }
+
+        // LinearQuantizer::recover_pred on every lane, returns the mask of unpredictable lanes
+        static inline uint32_t recover(const int *quant, vec pred, float eb, int radius, float *dec) {
+            __m512i q = _mm512_loadu_si512(quant);
+            __m512i q2 = _mm512_slli_epi32(_mm512_sub_epi32(q, _mm512_set1_epi32(radius)), 1);
+            _mm512_storeu_ps(dec, _mm512_add_ps(pred, _mm512_mul_ps(_mm512_cvtepi32_ps(q2), _mm512_set1_ps(eb))));
+            return (uint32_t) _mm512_cmpeq_epi32_mask(q, _mm512_setzero_si512());
+        }
+    };
+
+    template<>
+    struct simd_vector<double> {
+        typedef __m512d vec;
+        static const int width = 8;
+
+        static inline vec load_even(const double *p) {
+            const __m512i idx = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+            return _mm512_permutex2var_pd(_mm512_loadu_pd(p), idx, _mm512_loadu_pd(p + 8));
+        }
+
+        static inline vec load(const double *p) { return _mm512_loadu_pd(p); }
+
+        static inline vec set1(double v) { return _mm512_set1_pd(v); }
+
+        static inline vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+
+        static inline vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+
+        static inline vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+
+        static inline uint32_t quantize(vec x, vec pred, double eb, double eb_reciprocal, int radius,
+                                        int *quant, double *dec) {
+            vec diff = _mm512_sub_pd(x, pred);
+            vec qf = _mm512_min_pd(_mm512_mul_pd(_mm512_abs_pd(diff), _mm512_set1_pd(eb_reciprocal)),
+                                   _mm512_set1_pd(2.0 * radius));
+            __m256i qi = _mm256_add_epi32(_mm512_cvttpd_epi32(qf), _mm256_set1_epi32(1));
+            __mmask8 valid = (__mmask8) _mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(2 * radius), qi)));
+            __m256i half = _mm256_srai_epi32(qi, 1);
+            vec half_d = _mm512_cvtepi32_pd(half);
+            vec q2 = _mm512_cvtepi32_pd(_mm256_slli_epi32(half, 1));
+            __mmask8 neg = _mm512_cmp_pd_mask(diff, _mm512_setzero_pd(), _CMP_LT_OQ);
+            q2 = _mm512_mask_sub_pd(q2, neg, _mm512_setzero_pd(), q2);
+            vec d = _mm512_add_pd(pred, _mm512_mul_pd(q2, _mm512_set1_pd(eb)));
+            __mmask8 ok = valid & _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(d, x)), _mm512_set1_pd(eb),
+                                                     _CMP_NGT_UQ);
+            const vec r = _mm512_set1_pd(radius);
+            vec q = _mm512_mask_sub_pd(_mm512_add_pd(r, half_d), neg, r, half_d);
+            _mm256_storeu_si256((__m256i *) quant, _mm512_cvttpd_epi32(_mm512_maskz_mov_pd(ok, q)));
+            _mm512_storeu_pd(dec, _mm512_mask_blend_pd(ok, x, d));
+            return (uint32_t) (~ok & 0xff);
+        }
+
+        static inline uint32_t recover(const int *quant, vec pred, double eb, int radius, double *dec) {
+            __m256i q = _mm256_loadu_si256((const __m256i *) quant);
+            __m256i q2 = _mm256_slli_epi32(_mm256_sub_epi32(q, _mm256_set1_epi32(radius)), 1);
+            _mm512_storeu_pd(dec, _mm512_add_pd(pred, _mm512_mul_pd(_mm512_cvtepi32_pd(q2), _mm512_set1_pd(eb))));
+            return (uint32_t) _mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpeq_epi32(q, _mm256_setzero_si256())));
+        }
+    };
+
+#elif defined(__AVX2__)
+
+    template<>
+    struct simd_vector<float> {
+        typedef __m256 vec;
+        static const int width = 8;
+
+        static inline vec load_even(const float *p) {
+            __m256 s = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(2, 0, 2, 0));
+            return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+
+        static inline vec load(const float *p) { return _mm256_loadu_ps(p); }
+
+        static inline vec set1(float v) { return _mm256_set1_ps(v); }
+
+        static inline vec add(vec a, vec b) { return _mm256_add_ps(a, b); }
+
+        static inline vec sub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+
+        static inline vec mul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+
+        static inline uint32_t quantize(vec x, vec pred, float eb, float eb_reciprocal, int radius,
+                                        int *quant, float *dec) {
+            const vec sign = _mm256_set1_ps(-0.0f);
+            vec diff = _mm256_sub_ps(x, pred);
+            vec abs_diff = _mm256_andnot_ps(sign, diff);
+            // the scalar quantizer scales |diff| in double precision
+            const __m256d scale = _mm256_set1_pd(eb_reciprocal);
+            const __m256d limit = _mm256_set1_pd(2.0 * radius);
+            __m256d lo = _mm256_min_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(abs_diff)), scale), limit);
+            __m256d hi = _mm256_min_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(abs_diff, 1)), scale), limit);
+            __m256i qi = _mm256_set_m128i(_mm256_cvttpd_epi32(hi), _mm256_cvttpd_epi32(lo));
+            qi = _mm256_add_epi32(qi, _mm256_set1_epi32(1));
+            __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(2 * radius), qi);
+            __m256i half = _mm256_srai_epi32(qi, 1);
+            __m256i q2 = _mm256_slli_epi32(half, 1);
+            __m256i neg = _mm256_castps_si256(_mm256_cmp_ps(diff, _mm256_setzero_ps(), _CMP_LT_OQ));
+            q2 = _mm256_blendv_epi8(q2, _mm256_sub_epi32(_mm256_setzero_si256(), q2), neg);
+            vec d = _mm256_add_ps(pred, _mm256_mul_ps(_mm256_cvtepi32_ps(q2), _mm256_set1_ps(eb)));
+            __m256i ok = _mm256_and_si256(valid, _mm256_castps_si256(
+                    _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(d, x)), _mm256_set1_ps(eb), _CMP_NGT_UQ)));
+            const __m256i r = _mm256_set1_epi32(radius);
+            __m256i q = _mm256_blendv_epi8(_mm256_add_epi32(r, half), _mm256_sub_epi32(r, half), neg);
+            _mm256_storeu_si256((__m256i *) quant, _mm256_and_si256(q, ok));
+            _mm256_storeu_ps(dec, _mm256_blendv_ps(x, d, _mm256_castsi256_ps(ok)));
+            return (uint32_t) (~_mm256_movemask_ps(_mm256_castsi256_ps(ok)) & 0xff);
+        }
+
+        static inline uint32_t recover(const int *quant, vec pred, float eb, int radius, float *dec) {
+            __m256i q = _mm256_loadu_si256((const __m256i *) quant);
+            __m256i q2 = _mm256_slli_epi32(_mm256_sub_epi32(q, _mm256_set1_epi32(radius)), 1);
+            _mm256_storeu_ps(dec, _mm256_add_ps(pred, _mm256_mul_ps(_mm256_cvtepi32_ps(q2), _mm256_set1_ps(eb))));
+            return (uint32_t) _mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpeq_epi32(q, _mm256_setzero_si256())));
+        }
+    };
+
+    template<>
+    struct simd_vector<double> {
+        typedef __m256d vec;
+        static const int width = 4;
+
+        static inline vec load_even(const double *p) {
+            __m256d s = _mm256_unpacklo_pd(_mm256_loadu_pd(p), _mm256_loadu_pd(p + 4));
+            return _mm256_permute4x64_pd(s, _MM_SHUFFLE(3, 1, 2, 0));
+        }
+
+        static inline vec load(const double *p) { return _mm256_loadu_pd(p); }
+
+        static inline vec set1(double v) { return _mm256_set1_pd(v); }
+
+        static inline vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+
+        static inline vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+
+        static inline vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+
+        static inline uint32_t quantize(vec x, vec pred, double eb, double eb_reciprocal, int radius,
+                                        int *quant, double *dec) {
+            const vec sign = _mm256_set1_pd(-0.0);
+            vec diff = _mm256_sub_pd(x, pred);
+            vec qf = _mm256_min_pd(_mm256_mul_pd(_mm256_andnot_pd(sign, diff), _mm256_set1_pd(eb_reciprocal)),
+                                   _mm256_set1_pd(2.0 * radius));
+            __m128i qi = _mm_add_epi32(_mm256_cvttpd_epi32(qf), _mm_set1_epi32(1));
+            vec valid = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmplt_epi32(qi, _mm_set1_epi32(2 * radius))));
+            __m128i half = _mm_srai_epi32(qi, 1);
+            vec half_d = _mm256_cvtepi32_pd(half);
+            vec q2 = _mm256_cvtepi32_pd(_mm_slli_epi32(half, 1));
+            vec neg = _mm256_cmp_pd(diff, _mm256_setzero_pd(), _CMP_LT_OQ);
+            q2 = _mm256_blendv_pd(q2, _mm256_sub_pd(_mm256_setzero_pd(), q2), neg);
+            vec d = _mm256_add_pd(pred, _mm256_mul_pd(q2, _mm256_set1_pd(eb)));
+            vec ok = _mm256_and_pd(valid, _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(d, x)),
+                                                        _mm256_set1_pd(eb), _CMP_NGT_UQ));
+            const vec r = _mm256_set1_pd(radius);
+            vec q = _mm256_blendv_pd(_mm256_add_pd(r, half_d), _mm256_sub_pd(r, half_d), neg);
+            _mm_storeu_si128((__m128i *) quant, _mm256_cvttpd_epi32(_mm256_and_pd(q, ok)));
+            _mm256_storeu_pd(dec, _mm256_blendv_pd(x, d, ok));
+            return (uint32_t) (~_mm256_movemask_pd(ok) & 0xf);
+        }
+
+        static inline uint32_t recover(const int *quant, vec pred, double eb, int radius, double *dec) {
+            __m128i q = _mm_loadu_si128((const __m128i *) quant);
+            __m128i q2 = _mm_slli_epi32(_mm_sub_epi32(q, _mm_set1_epi32(radius)), 1);
+            _mm256_storeu_pd(dec, _mm256_add_pd(pred, _mm256_mul_pd(_mm256_cvtepi32_pd(q2), _mm256_set1_pd(eb))));
+            return (uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(q, _mm_setzero_si128())));
+        }
+    };
+
+#endif
+
+    // one point of width lines whose first points are lane_step (1 or 2) elements apart
+    template<class T, int lane_step>
+    inline typename simd_vector<T>::vec simd_load_lanes(const T *p) {
+        return lane_step == 1 ? simd_vector<T>::load(p) : simd_vector<T>::load_even(p);
+    }
+
+    // prediction of the lanes at p from their neighbours along lines with element stride `stride`
+    template<class T, INTERP_ALGO algo, int lane_step>
+    inline typename simd_vector<T>::vec simd_interp(const T *p, size_t stride, const T *coeffs) {
+        typedef simd_vector<T> V;
+        if (algo == INTERP_ALGO_LINEAR) {
+            return V::mul(V::add(simd_load_lanes<T, lane_step>(p - stride), simd_load_lanes<T, lane_step>(p + stride)),
+                          V::set1(0.5));
+        }
+        const typename V::vec a = simd_load_lanes<T, lane_step>(p - 3 * stride);
+        const typename V::vec b = simd_load_lanes<T, lane_step>(p - stride);
+        const typename V::vec c = simd_load_lanes<T, lane_step>(p + stride);
+        const typename V::vec d = simd_load_lanes<T, lane_step>(p + 3 * stride);
+        if (algo == INTERP_ALGO_CUBIC_P) {
+            return V::add(V::add(V::add(V::mul(a, V::set1(coeffs[0])), V::mul(b, V::set1(coeffs[1]))),
+                                 V::mul(c, V::set1(coeffs[2]))),
+                          V::mul(d, V::set1(coeffs[3])));
+        }
+        const typename V::vec nine = V::set1(9);
+        return V::mul(V::sub(V::add(V::sub(V::mul(nine, b), a), V::mul(nine, c)), d), V::set1(1.0 / 16));
+    }
+
+    // the kernels work on int indices, narrower storage goes through a buffer of width indices
+    inline int *simd_quant_out(int *quant, int *) {
+        return quant;
+    }
+
+    template<class Q>
+    inline int *simd_quant_out(Q *, int *buffer) {
+        return buffer;
+    }
+
+    template<int width>
+    inline void simd_store_quant(int *, const int (&)[width]) {}
+
+    template<class Q, int width>
+    inline void simd_store_quant(Q *quant, const int (&buffer)[width]) {
+        for (int j = 0; j < width; j++) {
+            quant[j] = buffer[j];
+        }
+    }
+
+    template<class T>
+    inline const int *simd_quant_in(const int *quant, int *) {
+        return quant;
+    }
+
+    template<class T, class Q>
+    inline const int *simd_quant_in(const Q *quant, int *buffer) {
+        for (int j = 0; j < simd_vector<T>::width; j++) {
+            buffer[j] = quant[j];
+        }
+        return buffer;
+    }
+
+    // predict and quantize line[i], line[i + 2], ... as long as whole vectors fit in the line of n points,
+    // unpredictable lanes are passed in order to unpred(index in quant, value); returns the first point left
+    template<class T, INTERP_ALGO algo, class Q, class Unpred>
+    inline size_t simd_interp_quantize(T *line, size_t i, size_t n, const T *coeffs, T eb, int radius,
+                                       Q *quant, Unpred &&unpred) {
+        typedef simd_vector<T> V;
+        const size_t margin = 2 * V::width + (algo == INTERP_ALGO_LINEAR ? 0 : 2);
+        const T eb_reciprocal = 1.0 / eb;
+        T dec[V::width];
+        int q[V::width];
+        for (size_t k = 0; i + margin < n; i += 2 * V::width, k += V::width) {
+            T *p = line + i;
+            uint32_t mask = V::quantize(V::load_even(p), simd_interp<T, algo, 2>(p, 1, coeffs), eb, eb_reciprocal,
+                                        radius, simd_quant_out(quant + k, q), dec);
+            simd_store_quant(quant + k, q);
+            for (int j = 0; j < V::width; j++) {
+                p[2 * j] = dec[j];
+            }
+            for (; mask; mask &= mask - 1) {
+                int j = __builtin_ctz(mask);
+                unpred(k + j, dec[j]);
+            }
+        }
+        return i;
+    }
+
+    // recover line[i], line[i + 2], ... as long as whole vectors fit in the line of n points,
+    // unpredictable lanes are taken in order from unpred(); returns the first point left
+    template<class T, INTERP_ALGO algo, class Q, class Unpred>
+    inline size_t simd_interp_recover(T *line, size_t i, size_t n, const T *coeffs, T eb, int radius,
+                                      const Q *quant, Unpred &&unpred) {
+        typedef simd_vector<T> V;
+        const size_t margin = 2 * V::width + (algo == INTERP_ALGO_LINEAR ? 0 : 2);
+        T dec[V::width];
+        int q[V::width];
+        for (size_t k = 0; i + margin < n; i += 2 * V::width, k += V::width) {
+            T *p = line + i;
+            uint32_t mask = V::recover(simd_quant_in<T>(quant + k, q), simd_interp<T, algo, 2>(p, 1, coeffs), eb,
+                                       radius, dec);
+            for (; mask; mask &= mask - 1) {
+                dec[__builtin_ctz(mask)] = unpred();
+            }
+            for (int j = 0; j < V::width; j++) {
+                p[2 * j] = dec[j];
+            }
+        }
+        return i;
+    }
+    // quantize one point of width lines whose quantization indices are quant_stride apart,
+    // unpredictable lanes are passed in order to unpred(lane, value)
+    template<class T, int lane_step, class Q, class Unpred>
+    inline void simd_lanes_quantize(T *p, typename simd_vector<T>::vec pred, T eb, T eb_reciprocal, int radius,
+                                    Q *quant, size_t quant_stride, Unpred &&unpred) {
+        typedef simd_vector<T> V;
+        int q[V::width];
+        T dec[V::width];
+        uint32_t mask = V::quantize(simd_load_lanes<T, lane_step>(p), pred, eb, eb_reciprocal, radius, q, dec);
+        for (int j = 0; j < V::width; j++) {
+            quant[j * quant_stride] = q[j];
+            p[j * lane_step] = dec[j];
+        }
+        for (; mask; mask &= mask - 1) {
+            int j = __builtin_ctz(mask);
+            unpred(j, dec[j]);
+        }
+    }
+
+    // recover one point of width lines whose quantization indices are quant_stride apart,
+    // unpredictable lanes are taken from unpred(lane)
+    template<class T, int lane_step, class Q, class Unpred>
+    inline void simd_lanes_recover(T *p, typename simd_vector<T>::vec pred, T eb, int radius,
+                                   const Q *quant, size_t quant_stride, Unpred &&unpred) {
+        typedef simd_vector<T> V;
+        int q[V::width];
+        T dec[V::width];
+        for (int j = 0; j < V::width; j++) {
+            q[j] = quant[j * quant_stride];
+        }
+        uint32_t mask = V::recover(q, pred, eb, radius, dec);
+        for (; mask; mask &= mask - 1) {
+            int j = __builtin_ctz(mask);
+            dec[j] = unpred(j);
+        }
+        for (int j = 0; j < V::width; j++) {
+            p[j * lane_step] = dec[j];
+        }
+    }
+}
+#endif //SZ_INTERPOLATORS_SIMD_HPP
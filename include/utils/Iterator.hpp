@@ -16,9 +16,19 @@
 
 namespace SZ {
 // N-dimensional multi_dimensional_range
+// Iterators point to their range without owning it, they are as cheap to copy as a pointer and an index;
+// the range has to outlive them, it may be on the stack.
     template<class T, uint N>
-    class multi_dimensional_range : public std::enable_shared_from_this<multi_dimensional_range<T, N>> {
+    class multi_dimensional_range {
     public:
+        // neighbors up to two layers back along every dimension, the offsets of prev_interior
+        static constexpr size_t neighbor_count = [] {
+            size_t count = 1;
+            for (uint i = 0; i < N; i++) {
+                count *= 3;
+            }
+            return count;
+        }();
 
         class multi_dimensional_iterator {
         public:
@@ -41,8 +51,8 @@ namespace SZ {
 
             multi_dimensional_iterator &operator=(multi_dimensional_iterator &&) noexcept = default;
 
-            multi_dimensional_iterator(std::shared_ptr<multi_dimensional_range> &&range_, std::size_t current_offset_) noexcept:
-                    range(range_), global_offset(current_offset_), local_index{} {
+            multi_dimensional_iterator(multi_dimensional_range *range_, std::size_t current_offset_) noexcept:
+                    range(range_), local_index{}, global_offset(current_offset_) {
             }
 
             multi_dimensional_iterator &operator--() {
@@ -87,11 +97,11 @@ namespace SZ {
             }
 
             pointer operator->() {
-                return range->data[global_offset];
+                return &range->data[global_offset];
             }
 
             pointer operator->() const {
-                return range->data[global_offset];
+                return &range->data[global_offset];
             }
 
             reference operator*() {
@@ -156,6 +166,38 @@ namespace SZ {
                 return range->data[offset];
             }
 
+            // true when prev reaches no point before the start of the range up to layers back along every
+            // dimension, so that prev_interior gives the same values; tested without branches
+            inline bool interior(uint layers) const noexcept {
+                bool inside = true;
+                for (uint i = 0; i < N; i++) {
+                    inside &= !range->start_position[i] | (local_index[i] >= layers);
+                }
+                return inside;
+            }
+
+            // prev for an interior point and pos up to 2, read at an offset of the neighbor table
+            template<class... Args>
+            inline T prev_interior(Args &&... pos) const noexcept {
+                static_assert(sizeof...(Args) == N, "Must have the same number of arguments");
+                std::array<size_t, N> args{static_cast<size_t>(std::forward<Args>(pos))...};
+                size_t neighbor = 0;
+                for (uint i = 0; i < N; i++) {
+                    assert(args[i] <= 2);
+                    neighbor = neighbor * 3 + args[i];
+                }
+                return range->data[global_offset - range->neighbor_offsets[neighbor]];
+            }
+
+            // the current point, the points of its row follow it at row_stride()
+            T *data() const noexcept {
+                return &range->data[global_offset];
+            }
+
+            size_t row_stride() const noexcept {
+                return range->global_dim_strides[N - 1];
+            }
+
             // No support for carry set.
             // For example, iterator in position (4,4) and dimension is 6x6, move(1,1) is supported but move (2,0) is not supported.
             template<class... Args>
@@ -204,7 +246,7 @@ namespace SZ {
 
         private:
             friend multi_dimensional_range;
-            std::shared_ptr<multi_dimensional_range> range;
+            multi_dimensional_range *range;
             std::array<size_t, N> local_index;        // index of current_offset position
             ptrdiff_t global_offset;
         };
@@ -216,11 +258,11 @@ namespace SZ {
         using pointer = T *;
 
         multi_dimensional_iterator begin() {
-            return multi_dimensional_iterator(this->shared_from_this(), start_offset);
+            return multi_dimensional_iterator(this, start_offset);
         }
 
         multi_dimensional_iterator end() {
-            return multi_dimensional_iterator(this->shared_from_this(), end_offset);
+            return multi_dimensional_iterator(this, end_offset);
         }
 
         template<class ForwardIt1>
@@ -250,6 +292,15 @@ namespace SZ {
                 cur_stride *= global_dimensions[i];
                 // std::cout << dim_strides[i] << " ";
             }
+            for (size_t neighbor = 0; neighbor < neighbor_count; neighbor++) {
+                ptrdiff_t offset = 0;
+                size_t digits = neighbor;
+                for (int i = N - 1; i >= 0; i--) {
+                    offset += (digits % 3) * global_dim_strides[i];
+                    digits /= 3;
+                }
+                neighbor_offsets[neighbor] = offset;
+            }
             // std::cout << std::endl;
         }
 
@@ -309,6 +360,15 @@ namespace SZ {
             return dimensions[i];
         }
 
+        // number of points
+        size_t size() const {
+            size_t num = 1;
+            for (const auto &d : dimensions) {
+                num *= d;
+            }
+            return num;
+        }
+
         std::array<size_t, N> get_dimensions() const {
             return dimensions;
         }
@@ -328,6 +388,7 @@ namespace SZ {
     private:
         std::array<size_t, N> global_dimensions;
         std::array<size_t, N> global_dim_strides;
+        std::array<ptrdiff_t, neighbor_count> neighbor_offsets; // offset of [a0, a1, ...] back, ai in 0..2, base 3
         std::array<size_t, N> dimensions;              // the dimensions
 //        std::array<size_t, N> dim_strides;              // strides for dimensions
         std::array<bool, N> start_position;       // indicator for starting position, used for block-wise lorenzo predictor
@@ -0,0 +1,111 @@
+#ifndef SZ_OUTPUT_ARENA_HPP
+#define SZ_OUTPUT_ARENA_HPP
+
+#include "def.hpp"
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace SZ {
+
+    // Output of a compressor before the lossless stage, kept in chunks that are added as it grows
+    // instead of one buffer sized for the worst case.
+    // A writer asks for room with reserve, writes through the pointer it gets and hands the moved pointer
+    // back to commit; the lossless stage reads the chunks in place.
+    class OutputArena {
+    public:
+        struct chunk {
+            std::unique_ptr<uchar[]> data;
+            size_t size = 0;
+            size_t capacity = 0;
+        };
+
+        explicit OutputArena(size_t chunk_size = 1 << 20) : chunk_size(chunk_size) {}
+
+        // the arena is not shared, copies start empty
+        OutputArena(const OutputArena &other) : chunk_size(other.chunk_size) {}
+
+        OutputArena &operator=(const OutputArena &other) {
+            chunk_size = other.chunk_size;
+            return *this;
+        }
+
+        OutputArena(OutputArena &&) = default;
+
+        OutputArena &operator=(OutputArena &&) = default;
+
+        // at least size contiguous bytes after the current output
+        uchar *reserve(size_t size) {
+            if (current < chunks.size() && chunks[current].capacity - chunks[current].size >= size) {
+                return chunks[current].data.get() + chunks[current].size;
+            }
+            if (current < chunks.size() && chunks[current].size) {
+                current++;
+            }
+            if (current == chunks.size()) {
+                chunks.emplace_back();
+            }
+            chunk &c = chunks[current];
+            if (c.capacity < size) {
+                c.capacity = std::max(size, chunk_size);
+                c.data.reset(new uchar[c.capacity]);
+            }
+            return c.data.get();
+        }
+
+        // end is the pointer returned by the last reserve moved past the written bytes
+        void commit(const uchar *end) {
+            chunk &c = chunks[current];
+            c.size = end - c.data.get();
+        }
+
+        size_t size() const {
+            size_t s = 0;
+            for (size_t i = 0; i < used_chunks(); i++) {
+                s += chunks[i].size;
+            }
+            return s;
+        }
+
+        // the chunks holding the output are the first used_chunks()
+        const std::vector<chunk> &get_chunks() const {
+            return chunks;
+        }
+
+        size_t used_chunks() const {
+            return current < chunks.size() ? current + 1 : chunks.size();
+        }
+
+        // the whole output in one buffer allocated with new[], after prefix bytes left to the caller
+        uchar *flatten(size_t prefix = 0) const {
+            uchar *data = new uchar[prefix + size()];
+            uchar *pos = data + prefix;
+            for (size_t i = 0; i < used_chunks(); i++) {
+                memcpy(pos, chunks[i].data.get(), chunks[i].size);
+                pos += chunks[i].size;
+            }
+            return data;
+        }
+
+        // empty the arena, the chunks are kept for the next output
+        void rewind() {
+            for (auto &c:chunks) {
+                c.size = 0;
+            }
+            current = 0;
+        }
+
+        // give the memory back
+        void clear() {
+            std::vector<chunk>().swap(chunks);
+            current = 0;
+        }
+
+    private:
+        std::vector<chunk> chunks;
+        size_t current = 0;
+        size_t chunk_size;
+    };
+}
+#endif
@@ -29,10 +29,10 @@ namespace SZ {
             return (double) (end.tv_sec - begin.tv_sec) + (double) (end.tv_nsec - begin.tv_nsec) / (double) 1000000000;
         }
 
+        // prints the time without flushing, which would show up in the timings of the caller
         double stop(const std::string &msg) {
             double seconds = stop();
-            std::cout << msg << " time = " << seconds << "s" << std::endl;
-            fflush(stdout);
+            std::cout << msg << " time = " << seconds << "s\n";
             return seconds;
         }
 
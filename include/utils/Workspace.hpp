@@ -0,0 +1,68 @@
+#ifndef SZ_WORKSPACE_HPP
+#define SZ_WORKSPACE_HPP
+
+#include "def.hpp"
+#include <memory>
+#include <vector>
+
+namespace SZ {
+
+    // Scratch memory of the decompressors, kept from one call to the next so that decompressing
+    // many fields of the same shape allocates nothing after the first one.
+    // Buffers only grow, their content is not kept when they do.
+    class Workspace {
+    public:
+        Workspace() = default;
+
+        // scratch memory is not shared, copies of a compressor start with an empty workspace
+        Workspace(const Workspace &) {}
+
+        Workspace &operator=(const Workspace &) {
+            return *this;
+        }
+
+        Workspace(Workspace &&) = default;
+
+        Workspace &operator=(Workspace &&) = default;
+
+        // buffer i of at least size bytes; call reserve first when several threads take buffers
+        uchar *bytes(size_t size, size_t i = 0) {
+            if (i >= buffers.size()) {
+                buffers.resize(i + 1);
+            }
+            buffer &b = buffers[i];
+            if (b.capacity < size) {
+                b.data.reset(new uchar[size]);
+                b.capacity = size;
+            }
+            return b.data.get();
+        }
+
+        void reserve(size_t num_buffers) {
+            if (buffers.size() < num_buffers) {
+                buffers.resize(num_buffers);
+            }
+        }
+
+        // quantization indices of num elements
+        std::vector<int> &quant_inds(size_t num) {
+            indices.resize(num);
+            return indices;
+        }
+
+        // give the memory back
+        void clear() {
+            std::vector<buffer>().swap(buffers);
+            std::vector<int>().swap(indices);
+        }
+
+    private:
+        struct buffer {
+            std::unique_ptr<uchar[]> data;
+            size_t capacity = 0;
+        };
+        std::vector<buffer> buffers;
+        std::vector<int> indices;
+    };
+}
+#endif
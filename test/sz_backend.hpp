@@ -71,8 +71,10 @@ float SZ_compress(std::unique_ptr<T[]> const &data,
     std::cout << "****************** Decompression ****************" << std::endl;
     compressed = SZ::readfile<SZ::uchar>(compressed_file_name.c_str(), compressed_size);
 
+    // into a buffer of the caller, as readers filling their own arrays do
+    std::unique_ptr<T[]> dec_buffer(new T[conf.num]);
     timer.start();
-    T *dec_data = sz.decompress(compressed.get(), compressed_size);
+    T *dec_data = sz.decompress(compressed.get(), compressed_size, dec_buffer.get());
     timer.stop("Decompression");
 
     SZ::verify<T>(data_.data(), dec_data, conf.num);
@@ -82,7 +84,6 @@ float SZ_compress(std::unique_ptr<T[]> const &data,
     SZ::writefile(decompressed_file_name.c_str(), dec_data, conf.num);
     std::cout << "Decompressed file = " << decompressed_file_name << std::endl;
 
-    delete[] dec_data;
     return ratio;
 }
 
@@ -42,6 +42,7 @@ interp_compress_decompress_nowritefile(char *path, float *data, size_t num, doub
     std::unique_ptr<unsigned char[]> compressed;
 
     auto dims = std::array<size_t, N>{static_cast<size_t>(std::forward<Dims>(args))...};
+    SZ::CompressionStats compress_stats;
     {
         auto sz = SZ::SZInterpolationCompressor<float, N, SZ::LinearQuantizer<float>, SZ::HuffmanEncoder<int>, SZ::Lossless_zstd>(
                 SZ::LinearQuantizer<float>(eb),
@@ -54,6 +55,7 @@ interp_compress_decompress_nowritefile(char *path, float *data, size_t num, doub
                 interp_level
         );
         compressed.reset(sz.compress(data, compressed_size, true));
+        compress_stats = sz.get_stats();
     }
 
     clock_gettime(CLOCK_REALTIME, &end);
@@ -61,6 +63,7 @@ interp_compress_decompress_nowritefile(char *path, float *data, size_t num, doub
             (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / (double) 1000000000;
     auto compression_ratio = num * sizeof(float) * 1.0 / compressed_size;
     compressInfo.compress_time = compress_time;
+    compress_stats.print();
     std::cout << "LEVEL2 Interp compression time = " << compress_time << "s" << std::endl;
     std::cout << "Compressed size = " << compressed_size << std::endl;
     std::cout << "Compression ratio = " << compression_ratio << std::endl;
@@ -148,6 +151,10 @@ interp_compress_decompress(char *path, float *data, size_t num, double eb, int i
                 direction_op,
                 interp_level
         );
+        // a negative interp_op lets the compressor choose the interpolator and the direction,
+        // and the interpolator of every level and dimension
+        sz.set_auto_tuning(interp_op < 0);
+        sz.set_level_interpolators(interp_op < 0);
         compressed.reset(sz.compress(data, compressed_size));
 
 
@@ -192,7 +199,8 @@ interp_compress_decompress(char *path, float *data, size_t num, double eb, int i
                 direction_op,
                 interp_level
         );
-        dec_data.reset(sz.decompress(compressed.get(), compressed_size));
+        dec_data.reset(new float[num]);
+        sz.decompress(compressed.get(), compressed_size, dec_data.get());
 
 
         clock_gettime(CLOCK_REALTIME, &end);
@@ -374,31 +382,11 @@ META::meta_compress_info interp_tuning(char *path, double reb, Dims ... args) {
     }
     float eb = reb * (max - min);
     int interp_level = -1;
-    int interp_op, direction_op = 0, block_size = 6, interp_block_size = 32;
+    // a negative interp_op makes the compressor estimate the interpolators and the directions from a sample
+    // of the data instead of compressing it once for every candidate
+    int interp_op = -1, direction_op = 0, block_size = 6, interp_block_size = 32;
     SZ_Option sz_op = SZ_LR;
 
-    double best_ratio = 0, ratio;
-    for (int i = 0; i < 2; i++) {
-        ratio = interp_compress_test<N>(data.get(), num, eb, interp_level, i, direction_op, block_size,
-                                        interp_block_size, sz_op,
-                                        args...);
-        if (ratio > best_ratio) {
-            best_ratio = ratio;
-            interp_op = i;
-        }
-    }
-    std::cout << "LEVEL1 best interp_op = " << interp_op << " , best ratio = " << best_ratio << std::endl;
-
-    int direction_op_reverse = std::tgamma(N + 1) - 1;
-    ratio = interp_compress_test<N>(data.get(), num, eb, interp_level, interp_op, direction_op_reverse, block_size, interp_block_size,
-                                    sz_op,
-                                    args...);
-    if (ratio > best_ratio * 1.0) {
-        best_ratio = ratio;
-        direction_op = direction_op_reverse;
-    }
-    std::cout << "LEVEL1 best direction_op = " << direction_op << " , best ratio = " << best_ratio << std::endl;
-
     return interp_compress_decompress<N>(path, data.get(), num, eb, interp_level, interp_op, direction_op, block_size,
                                          interp_block_size, sz_op,
                                          args...);
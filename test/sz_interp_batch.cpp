@@ -0,0 +1,130 @@
+#include <compressor/SZInterpolationCompressor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Verification.hpp>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// compress the fields with a new compressor each, then with one compressor for the batch
+template<uint N>
+void interp_batch_compress_decompress(std::vector<std::unique_ptr<float[]>> &fields, size_t num, double eb,
+                                      std::array<size_t, N> dims) {
+    auto make_compressor = [&]() {
+        return SZ::SZInterpolationCompressor<float, N, SZ::LinearQuantizer<float>, SZ::HuffmanEncoder<int>,
+                SZ::Lossless_zstd>(
+                SZ::LinearQuantizer<float>(eb),
+                SZ::HuffmanEncoder<int>(),
+                SZ::Lossless_zstd(),
+                dims,
+                32,
+                1,
+                0,
+                -1
+        );
+    };
+    std::vector<std::vector<float>> inputs;
+    for (auto &field : fields) {
+        inputs.emplace_back(field.get(), field.get() + num);
+    }
+
+    SZ::Timer timer(true);
+    size_t single_size = 0;
+    for (auto &input : inputs) {
+        std::vector<float> data(input);
+        auto sz = make_compressor();
+        size_t compressed_size = 0;
+        std::unique_ptr<SZ::uchar[]> compressed(sz.compress(data.data(), compressed_size));
+        single_size += compressed_size;
+    }
+    double single_time = timer.stop();
+
+    auto sz = make_compressor();
+    std::vector<float *> data;
+    for (auto &input : inputs) {
+        data.push_back(input.data());
+    }
+    std::vector<size_t> compressed_sizes;
+    timer.start();
+    std::vector<SZ::uchar *> compressed = sz.compress_batch(data, compressed_sizes);
+    double batch_time = timer.stop();
+
+    std::vector<std::unique_ptr<float[]>> dec_fields;
+    std::vector<float *> dec_data;
+    for (size_t f = 0; f < fields.size(); f++) {
+        dec_fields.emplace_back(new float[num]);
+        dec_data.push_back(dec_fields[f].get());
+    }
+    timer.start();
+    sz.decompress_batch(std::vector<SZ::uchar const *>(compressed.begin(), compressed.end()), compressed_sizes,
+                        dec_data);
+    double decompress_time = timer.stop();
+
+    size_t batch_size = 0;
+    for (size_t f = 0; f < fields.size(); f++) {
+        double psnr, nrmse;
+        SZ::verify<float>(fields[f].get(), dec_data[f], num, psnr, nrmse);
+        printf("field %zu: PSNR = %f, NRMSE = %.10G, Compression Ratio = %.2f\n", f, psnr, nrmse,
+               num * sizeof(float) * 1.0 / compressed_sizes[f]);
+        batch_size += compressed_sizes[f];
+        delete[] compressed[f];
+    }
+    printf("fields = %zu, one compressor per field: time = %f, size = %zu; "
+           "batch: compression time = %f, decompression time = %f, size = %zu\n",
+           fields.size(), single_time, single_size, batch_time, decompress_time, batch_size);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " -num_dim dim0 .. dimn relative_eb data_file [data_file ...]"
+                  << std::endl;
+        std::cout << "the error bound is relative to the value range of the first field" << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " -3 100 500 500 1e-3 Uf48.bin.dat Vf48.bin.dat Wf48.bin.dat" << std::endl;
+        return 0;
+    }
+
+    int dim = atoi(argv[1] + 1);
+    assert(1 <= dim && dim <= 4);
+    int argp = 2;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+
+    size_t num = 0;
+    std::vector<std::unique_ptr<float[]>> fields;
+    for (; argp < argc; argp++) {
+        size_t field_num = 0;
+        fields.push_back(SZ::readfile<float>(argv[argp], field_num));
+        assert(fields.size() == 1 || field_num == num);
+        num = field_num;
+    }
+    std::cout << "Read " << fields.size() << " fields of " << num << " elements\n";
+
+    float max = fields[0][0];
+    float min = fields[0][0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < fields[0][i]) max = fields[0][i];
+        if (min > fields[0][i]) min = fields[0][i];
+    }
+    double eb = reb * (max - min);
+
+    if (dim == 1) {
+        interp_batch_compress_decompress<1>(fields, num, eb, std::array<size_t, 1>{dims[0]});
+    } else if (dim == 2) {
+        interp_batch_compress_decompress<2>(fields, num, eb, std::array<size_t, 2>{dims[0], dims[1]});
+    } else if (dim == 3) {
+        interp_batch_compress_decompress<3>(fields, num, eb, std::array<size_t, 3>{dims[0], dims[1], dims[2]});
+    } else if (dim == 4) {
+        interp_batch_compress_decompress<4>(fields, num, eb,
+                                            std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]});
+    }
+    return 0;
+}
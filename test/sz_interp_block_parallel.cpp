@@ -0,0 +1,109 @@
+#include <compressor/SZBlockInterpolationCompressor.hpp>
+#include <predictor/LorenzoPredictor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Verification.hpp>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+template<uint N>
+void block_interp_parallel_compress_decompress(float *data, size_t num, double eb, std::array<size_t, N> dims,
+                                               size_t batch_elements, int threads) {
+    SZ::Config<float, N> conf(eb, dims);
+    conf.block_size = 16;
+    conf.stride = conf.block_size;
+    auto sz = SZ::make_sz_fast_block_interpolation_compressor(
+            conf,
+            SZ::LorenzoPredictor<float, N, 1>(eb),
+            SZ::LinearQuantizer<float>(eb),
+            SZ::HuffmanEncoder<int>(),
+            SZ::Lossless_zstd(),
+            1,
+            0,
+            0
+    );
+    sz.set_batch_elements(batch_elements);
+    sz.set_num_threads(threads);
+
+    std::cout << "****************** Compression ******************" << std::endl;
+    std::vector<float> input(data, data + num);
+    SZ::Timer timer(true);
+    size_t compressed_size = 0;
+    std::unique_ptr<SZ::uchar[]> compressed(sz.compress(input.data(), compressed_size));
+    double compress_time = timer.stop("Compression");
+
+    std::cout << "****************** Decompression ****************" << std::endl;
+    timer.start();
+    std::unique_ptr<float[]> dec_data(sz.decompress(compressed.get(), compressed_size));
+    double decompress_time = timer.stop("Decompression");
+
+    double psnr, nrmse;
+    SZ::verify<float>(data, dec_data.get(), num, psnr, nrmse);
+    printf("Batch elements = %zu, threads = %d, compression time = %f, decompression time = %f\n",
+           batch_elements, threads, compress_time, decompress_time);
+    printf("PSNR = %f, NRMSE = %.10G, Compression Ratio = %.2f\n", psnr, nrmse,
+           num * sizeof(float) * 1.0 / compressed_size);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " data_file -num_dim dim0 .. dimn relative_eb [batch_elements] [threads]"
+                  << std::endl;
+        std::cout << "batch_elements = 0 compresses all the blocks in one batch" << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " qmcpack.dat -3 33120 69 69 1e-3 1048576 8" << std::endl;
+        return 0;
+    }
+
+    size_t num = 0;
+    auto data = SZ::readfile<float>(argv[1], num);
+    std::cout << "Read " << num << " elements\n";
+
+    int dim = atoi(argv[2] + 1);
+    assert(1 <= dim && dim <= 4);
+    int argp = 3;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+    size_t batch_elements = 1 << 20;
+    if (argp < argc) {
+        batch_elements = atol(argv[argp++]);
+    }
+    int threads = 1;
+    if (argp < argc) {
+        threads = atoi(argv[argp++]);
+    }
+
+    float max = data[0];
+    float min = data[0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < data[i]) max = data[i];
+        if (min > data[i]) min = data[i];
+    }
+    double eb = reb * (max - min);
+
+    if (dim == 1) {
+        block_interp_parallel_compress_decompress<1>(data.get(), num, eb, std::array<size_t, 1>{dims[0]},
+                                                     batch_elements, threads);
+    } else if (dim == 2) {
+        block_interp_parallel_compress_decompress<2>(data.get(), num, eb,
+                                                     std::array<size_t, 2>{dims[0], dims[1]}, batch_elements,
+                                                     threads);
+    } else if (dim == 3) {
+        block_interp_parallel_compress_decompress<3>(data.get(), num, eb,
+                                                     std::array<size_t, 3>{dims[0], dims[1], dims[2]},
+                                                     batch_elements, threads);
+    } else if (dim == 4) {
+        block_interp_parallel_compress_decompress<4>(data.get(), num, eb,
+                                                     std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]},
+                                                     batch_elements, threads);
+    }
+    return 0;
+}
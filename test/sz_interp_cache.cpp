@@ -0,0 +1,159 @@
+#include <compressor/SZInterpolationCompressor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// last level cache misses of this process, every miss moves one 64-byte line from memory
+class llc_counter {
+public:
+    llc_counter() {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~llc_counter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // bytes moved from memory since start
+    double stop() {
+        long long misses = 0;
+#ifdef __linux__
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) misses = 0;
+#endif
+        return misses * 64.0;
+    }
+
+private:
+    int fd = -1;
+};
+
+template<uint N>
+void interp_cache_benchmark(float *data, size_t num, double eb, std::array<size_t, N> dims, size_t cache_size) {
+    llc_counter counter;
+    if (!counter.available()) {
+        std::cout << "perf events unavailable, bytes moved are not reported" << std::endl;
+    }
+    std::vector<float> input(num);
+    for (size_t cache : {size_t(0), cache_size}) {
+        auto sz = SZ::SZInterpolationCompressor<float, N, SZ::LinearQuantizer<float>, SZ::HuffmanEncoder<int>,
+                SZ::Lossless_zstd>(
+                SZ::LinearQuantizer<float>(eb),
+                SZ::HuffmanEncoder<int>(),
+                SZ::Lossless_zstd(),
+                dims,
+                32,
+                1,
+                0,
+                -1
+        );
+        sz.set_cache_size(cache);
+        std::copy(data, data + num, input.begin());
+
+        SZ::Timer timer(true);
+        counter.start();
+        size_t compressed_size = 0;
+        std::unique_ptr<SZ::uchar[]> compressed(sz.compress(input.data(), compressed_size));
+        double compress_bytes = counter.stop();
+        double compress_time = timer.stop();
+
+        timer.start();
+        counter.start();
+        std::unique_ptr<float[]> dec_data(sz.decompress(compressed.get(), compressed_size));
+        double decompress_bytes = counter.stop();
+        double decompress_time = timer.stop();
+
+        printf("cache size = %zu: compression time = %f, decompression time = %f", cache, compress_time,
+               decompress_time);
+        if (counter.available()) {
+            printf(", bytes moved per element = %.2f / %.2f", compress_bytes / num, decompress_bytes / num);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " data_file -num_dim dim0 .. dimn relative_eb [cache_size_kb]"
+                  << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " qmcpack.dat -3 33120 69 69 1e-3 1024" << std::endl;
+        return 0;
+    }
+
+    size_t num = 0;
+    auto data = SZ::readfile<float>(argv[1], num);
+    std::cout << "Read " << num << " elements\n";
+
+    int dim = atoi(argv[2] + 1);
+    assert(1 <= dim && dim <= 4);
+    int argp = 3;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+    size_t cache_size = 1024 * 1024;
+    if (argp < argc) {
+        cache_size = atol(argv[argp++]) * 1024;
+    }
+
+    float max = data[0];
+    float min = data[0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < data[i]) max = data[i];
+        if (min > data[i]) min = data[i];
+    }
+    double eb = reb * (max - min);
+
+    if (dim == 1) {
+        interp_cache_benchmark<1>(data.get(), num, eb, std::array<size_t, 1>{dims[0]}, cache_size);
+    } else if (dim == 2) {
+        interp_cache_benchmark<2>(data.get(), num, eb, std::array<size_t, 2>{dims[0], dims[1]}, cache_size);
+    } else if (dim == 3) {
+        interp_cache_benchmark<3>(data.get(), num, eb, std::array<size_t, 3>{dims[0], dims[1], dims[2]},
+                                  cache_size);
+    } else if (dim == 4) {
+        interp_cache_benchmark<4>(data.get(), num, eb,
+                                  std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]}, cache_size);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <compressor/SZChunkedInterpolationCompressor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Verification.hpp>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+template<uint N>
+void interp_chunked_compress_decompress(float *data, size_t num, double eb,
+                                        std::array<size_t, N> dims, size_t chunk_size, int threads) {
+    auto sz = SZ::SZChunkedInterpolationCompressor<float, N, SZ::LinearQuantizer<float>,
+            SZ::HuffmanEncoder<int>, SZ::Lossless_zstd>(
+            SZ::LinearQuantizer<float>(eb),
+            SZ::HuffmanEncoder<int>(),
+            SZ::Lossless_zstd(),
+            dims,
+            chunk_size,
+            32,
+            1,
+            0,
+            -1
+    );
+    sz.set_num_threads(threads);
+
+    std::cout << "****************** Compression ******************" << std::endl;
+    SZ::Timer timer(true);
+    size_t compressed_size = 0;
+    std::unique_ptr<SZ::uchar[]> compressed(sz.compress(data, compressed_size));
+    double compress_time = timer.stop("Compression");
+
+    std::cout << "****************** Decompression ****************" << std::endl;
+    timer.start();
+    std::unique_ptr<float[]> dec_data(sz.decompress(compressed.get(), compressed_size));
+    double decompress_time = timer.stop("Decompression");
+
+    double psnr, nrmse;
+    SZ::verify<float>(data, dec_data.get(), num, psnr, nrmse);
+    printf("Chunk size = %zu, threads = %d, compression time = %f, decompression time = %f\n",
+           chunk_size, threads, compress_time, decompress_time);
+    printf("PSNR = %f, NRMSE = %.10G, Compression Ratio = %.2f\n", psnr, nrmse,
+           num * sizeof(float) * 1.0 / compressed_size);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " data_file -num_dim dim0 .. dimn relative_eb [chunk_size] [threads]"
+                  << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " qmcpack.dat -3 33120 69 69 1e-3 128 8" << std::endl;
+        return 0;
+    }
+
+    size_t num = 0;
+    auto data = SZ::readfile<float>(argv[1], num);
+    std::cout << "Read " << num << " elements\n";
+
+    int dim = atoi(argv[2] + 1);
+    assert(1 <= dim && dim <= 5);
+    int argp = 3;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+    size_t chunk_size = 128;
+    if (argp < argc) {
+        chunk_size = atoi(argv[argp++]);
+    }
+    int threads = 1;
+    if (argp < argc) {
+        threads = atoi(argv[argp++]);
+    }
+
+    float max = data[0];
+    float min = data[0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < data[i]) max = data[i];
+        if (min > data[i]) min = data[i];
+    }
+    double eb = reb * (max - min);
+
+    if (dim == 1) {
+        interp_chunked_compress_decompress<1>(data.get(), num, eb, std::array<size_t, 1>{dims[0]},
+                                              chunk_size, threads);
+    } else if (dim == 2) {
+        interp_chunked_compress_decompress<2>(data.get(), num, eb,
+                                              std::array<size_t, 2>{dims[0], dims[1]}, chunk_size, threads);
+    } else if (dim == 3) {
+        interp_chunked_compress_decompress<3>(data.get(), num, eb,
+                                              std::array<size_t, 3>{dims[0], dims[1], dims[2]}, chunk_size,
+                                              threads);
+    } else if (dim == 4) {
+        interp_chunked_compress_decompress<4>(data.get(), num, eb,
+                                              std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]},
+                                              chunk_size, threads);
+    } else if (dim == 5) {
+        interp_chunked_compress_decompress<5>(data.get(), num, eb,
+                                              std::array<size_t, 5>{dims[0], dims[1], dims[2], dims[3], dims[4]},
+                                              chunk_size, threads);
+    }
+    return 0;
+}
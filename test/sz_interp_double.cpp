@@ -42,6 +42,7 @@ interp_compress_decompress_nowritefile(char *path, T *data, size_t num, double e
     std::unique_ptr<unsigned char[]> compressed;
 
     auto dims = std::array<size_t, N>{static_cast<size_t>(std::forward<Dims>(args))...};
+    SZ::CompressionStats compress_stats;
     {
         auto sz = SZ::SZInterpolationCompressor<T, N, SZ::LinearQuantizer<T>, SZ::HuffmanEncoder<int>, SZ::Lossless_zstd>(
                 SZ::LinearQuantizer<T>(eb),
@@ -54,6 +55,7 @@ interp_compress_decompress_nowritefile(char *path, T *data, size_t num, double e
                 interp_level
         );
         compressed.reset(sz.compress(data, compressed_size, true));
+        compress_stats = sz.get_stats();
     }
 
     clock_gettime(CLOCK_REALTIME, &end);
@@ -61,6 +63,7 @@ interp_compress_decompress_nowritefile(char *path, T *data, size_t num, double e
             (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / (double) 1000000000;
     auto compression_ratio = num * sizeof(T) * 1.0 / compressed_size;
     compressInfo.compress_time = compress_time;
+    compress_stats.print();
     std::cout << "LEVEL2 Interp compression time = " << compress_time << "s" << std::endl;
     std::cout << "Compressed size = " << compressed_size << std::endl;
     std::cout << "Compression ratio = " << compression_ratio << std::endl;
@@ -0,0 +1,117 @@
+#include <compressor/SZInterpolationCompressor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// compress with level sections, then decompress down to every level from the coarsest one
+template<uint N>
+void interp_progressive_decompress(float *data, size_t num, double eb, std::array<size_t, N> dims, bool codebooks) {
+    auto sz = SZ::SZInterpolationCompressor<float, N, SZ::LinearQuantizer<float>, SZ::HuffmanEncoder<int>,
+            SZ::Lossless_zstd>(
+            SZ::LinearQuantizer<float>(eb),
+            SZ::HuffmanEncoder<int>(),
+            SZ::Lossless_zstd(),
+            dims,
+            32,
+            1,
+            0,
+            -1
+    );
+    sz.set_level_sections(true);
+    sz.set_level_codebooks(codebooks);
+    std::vector<float> input(data, data + num);
+    size_t compressed_size = 0;
+    std::unique_ptr<SZ::uchar[]> compressed(sz.compress(input.data(), compressed_size));
+    printf("Compression Ratio = %.2f\n", num * sizeof(float) * 1.0 / compressed_size);
+
+    uint levels = 0;
+    while ((size_t(1) << levels) < *std::max_element(dims.begin(), dims.end())) {
+        levels++;
+    }
+    for (uint level = levels; level > 0; level--) {
+        std::array<size_t, N> coarse_dims;
+        SZ::Timer timer(true);
+        std::unique_ptr<float[]> coarse(sz.decompress_level(compressed.get(), compressed_size, level, coarse_dims));
+        double decompress_time = timer.stop();
+
+        size_t stride = size_t(1) << (level - 1);
+        size_t coarse_size = 1;
+        for (int i = 0; i < N; i++) {
+            coarse_size *= coarse_dims[i];
+        }
+        double max_err = 0;
+        std::array<size_t, N> idx{};
+        for (size_t c = 0; c < coarse_size; c++) {
+            size_t offset = 0;
+            for (int i = 0; i < N; i++) {
+                offset = offset * dims[i] + idx[i] * stride;
+            }
+            max_err = std::max(max_err, (double) fabs(coarse[c] - data[offset]));
+            for (int i = N - 1; i >= 0; i--) {
+                if (++idx[i] < coarse_dims[i]) {
+                    break;
+                }
+                idx[i] = 0;
+            }
+        }
+        printf("level %u: %zu points, decompression time = %f, max error = %G\n", level, coarse_size,
+               decompress_time, max_err);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " data_file -num_dim dim0 .. dimn relative_eb [level_codebooks]"
+                  << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " qmcpack.dat -3 33120 69 69 1e-3 1" << std::endl;
+        return 0;
+    }
+
+    size_t num = 0;
+    auto data = SZ::readfile<float>(argv[1], num);
+    std::cout << "Read " << num << " elements\n";
+
+    int dim = atoi(argv[2] + 1);
+    assert(1 <= dim && dim <= 4);
+    int argp = 3;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+    bool codebooks = false;
+    if (argp < argc) {
+        codebooks = atoi(argv[argp++]);
+    }
+
+    float max = data[0];
+    float min = data[0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < data[i]) max = data[i];
+        if (min > data[i]) min = data[i];
+    }
+    double eb = reb * (max - min);
+
+    if (dim == 1) {
+        interp_progressive_decompress<1>(data.get(), num, eb, std::array<size_t, 1>{dims[0]}, codebooks);
+    } else if (dim == 2) {
+        interp_progressive_decompress<2>(data.get(), num, eb, std::array<size_t, 2>{dims[0], dims[1]}, codebooks);
+    } else if (dim == 3) {
+        interp_progressive_decompress<3>(data.get(), num, eb, std::array<size_t, 3>{dims[0], dims[1], dims[2]},
+                                         codebooks);
+    } else if (dim == 4) {
+        interp_progressive_decompress<4>(data.get(), num, eb,
+                                         std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]}, codebooks);
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <compressor/SZInterpolationCompressor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/FileUtil.h>
+#include <utils/Timer.hpp>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// decompress one slice orthogonal to slice_dim and compare it with the same slice of the full decompression,
+// returns the number of points that differ
+template<uint N>
+size_t interp_region_decompress(float *data, size_t num, double eb, std::array<size_t, N> dims,
+                                int slice_dim, size_t slice_index, bool sections) {
+    auto sz = SZ::SZInterpolationCompressor<float, N, SZ::LinearQuantizer<float>, SZ::HuffmanEncoder<int>,
+            SZ::Lossless_zstd>(
+            SZ::LinearQuantizer<float>(eb),
+            SZ::HuffmanEncoder<int>(),
+            SZ::Lossless_zstd(),
+            dims,
+            32,
+            1,
+            0,
+            -1
+    );
+    sz.set_level_sections(sections);
+    size_t compressed_size = 0;
+    std::unique_ptr<SZ::uchar[]> compressed(sz.compress(data, compressed_size));
+
+    SZ::Timer timer(true);
+    std::unique_ptr<float[]> dec_data(sz.decompress(compressed.get(), compressed_size));
+    double decompress_time = timer.stop();
+
+    std::array<size_t, N> begin{}, end = dims;
+    begin[slice_dim] = slice_index;
+    end[slice_dim] = slice_index + 1;
+    timer.start();
+    std::unique_ptr<float[]> region(sz.decompress_region(compressed.get(), compressed_size, begin, end));
+    double region_time = timer.stop();
+
+    size_t region_size = num / dims[slice_dim];
+    size_t mismatches = 0;
+    std::array<size_t, N> idx = begin;
+    for (size_t r = 0; r < region_size; r++) {
+        size_t offset = 0;
+        for (int i = 0; i < N; i++) {
+            offset = offset * dims[i] + idx[i];
+        }
+        mismatches += region[r] != dec_data[offset];
+        for (int i = N - 1; i >= 0; i--) {
+            if (++idx[i] < end[i]) {
+                break;
+            }
+            idx[i] = begin[i];
+        }
+    }
+    printf("slice %zu of dimension %d: full decompression time = %f, region decompression time = %f, "
+           "mismatches = %zu\n", slice_index, slice_dim, decompress_time, region_time, mismatches);
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cout << "usage: " << argv[0] <<
+                  " data_file -num_dim dim0 .. dimn relative_eb [slice_dim] [slice_index] [level_sections]"
+                  << std::endl;
+        std::cout << "example: " << argv[0] <<
+                  " qmcpack.dat -3 33120 69 69 1e-3 0 100 1" << std::endl;
+        return 0;
+    }
+
+    size_t num = 0;
+    auto data = SZ::readfile<float>(argv[1], num);
+    std::cout << "Read " << num << " elements\n";
+
+    int dim = atoi(argv[2] + 1);
+    assert(1 <= dim && dim <= 4);
+    int argp = 3;
+    std::vector<size_t> dims(dim);
+    for (int i = 0; i < dim; i++) {
+        dims[i] = atoi(argv[argp++]);
+    }
+    float reb = atof(argv[argp++]);
+    int slice_dim = 0;
+    if (argp < argc) {
+        slice_dim = atoi(argv[argp++]);
+    }
+    assert(0 <= slice_dim && slice_dim < dim);
+    size_t slice_index = dims[slice_dim] / 2;
+    if (argp < argc) {
+        slice_index = atol(argv[argp++]);
+    }
+    bool sections = false;
+    if (argp < argc) {
+        sections = atoi(argv[argp++]);
+    }
+
+    float max = data[0];
+    float min = data[0];
+    for (size_t i = 1; i < num; i++) {
+        if (max < data[i]) max = data[i];
+        if (min > data[i]) min = data[i];
+    }
+    double eb = reb * (max - min);
+
+    size_t mismatches = 0;
+    if (dim == 1) {
+        mismatches = interp_region_decompress<1>(data.get(), num, eb, std::array<size_t, 1>{dims[0]}, slice_dim,
+                                                 slice_index, sections);
+    } else if (dim == 2) {
+        mismatches = interp_region_decompress<2>(data.get(), num, eb, std::array<size_t, 2>{dims[0], dims[1]},
+                                                 slice_dim, slice_index, sections);
+    } else if (dim == 3) {
+        mismatches = interp_region_decompress<3>(data.get(), num, eb,
+                                                 std::array<size_t, 3>{dims[0], dims[1], dims[2]}, slice_dim,
+                                                 slice_index, sections);
+    } else if (dim == 4) {
+        mismatches = interp_region_decompress<4>(data.get(), num, eb,
+                                                 std::array<size_t, 4>{dims[0], dims[1], dims[2], dims[3]},
+                                                 slice_dim, slice_index, sections);
+    }
+    return mismatches != 0;
+}
@@ -0,0 +1,99 @@
+#include <compressor/SZBlockInterpolationCompressor.hpp>
+#include <predictor/LorenzoPredictor.hpp>
+#include <quantizer/IntegerQuantizer.hpp>
+#include <encoder/HuffmanEncoder.hpp>
+#include <lossless/Lossless_zstd.hpp>
+#include <utils/Iterator.hpp>
+#include <utils/Timer.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Cost per element of setting up the blocks of SZBlockInterpolationCompressor on an n^3 grid:
+// the range of the points interpolation starts from and the number of levels of every block,
+// made the way the compressor used to (a new range and floating point levels per block)
+// and by the compressor itself (setup_blocks, one range for all the blocks and integer levels).
+
+using range_t = SZ::multi_dimensional_range<float, 3>;
+
+struct setup_result {
+    double seconds;
+    double checksum;
+};
+
+setup_result per_block_setup(std::vector<float> &data, const std::array<size_t, 3> &dims, size_t block_size) {
+    range_t inter_block_range(data.data(), dims.begin(), dims.end(), block_size, 0);
+    double checksum = 0;
+    SZ::Timer timer(true);
+    auto inter_end = inter_block_range.end();
+    for (auto block = inter_block_range.begin(); block != inter_end; ++block) {
+        auto block_idx = block.get_global_index();
+        std::array<size_t, 3> block_dims, stationary_dims;
+        uint levels = 1;
+        for (int i = 0; i < 3; i++) {
+            block_dims[i] = std::min(block_size, dims[i] - block_idx[i]);
+            if (levels < ceil(log2(block_dims[i]))) {
+                levels = (uint) ceil(log2(block_dims[i]));
+            }
+        }
+        size_t stride = (size_t) 1 << levels;
+        for (int i = 0; i < 3; i++) {
+            stationary_dims[i] = ceil(1.0 * block_dims[i] / stride);
+        }
+        auto range = std::make_shared<range_t>(data.data(), dims.begin(), dims.end(), stride, 0);
+        range->set_dimensions(stationary_dims.begin(), stationary_dims.end());
+        range->set_offsets(block.get_offset());
+        range->set_starting_position(block.get_local_index());
+        checksum += *range->begin() + levels;
+    }
+    return {timer.stop(), checksum};
+}
+
+setup_result compressor_setup(std::vector<float> &data, const std::array<size_t, 3> &dims, size_t block_size) {
+    SZ::Config<float, 3> conf(1e-3, dims);
+    conf.block_size = block_size;
+    conf.stride = conf.block_size;
+    // enough levels for the largest block, so every block keeps its own number of levels
+    auto sz = SZ::make_sz_fast_block_interpolation_compressor(
+            conf,
+            SZ::LorenzoPredictor<float, 3, 1>(1e-3),
+            SZ::LinearQuantizer<float>(1e-3),
+            SZ::HuffmanEncoder<int>(),
+            SZ::Lossless_zstd(),
+            1,
+            0,
+            32
+    );
+    SZ::Timer timer(true);
+    double checksum = sz.setup_blocks(data.data());
+    return {timer.stop(), checksum};
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? atol(argv[1]) : 192;
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    std::array<size_t, 3> dims{n, n, n};
+    size_t num = n * n * n;
+    std::vector<float> data(num);
+    for (size_t i = 0; i < num; i++) {
+        data[i] = sin(i * 1e-3);
+    }
+    printf("grid = %zu^3, best of %d runs\n", n, repeats);
+    for (size_t block_size: {4, 6, 8, 16, 32}) {
+        double per_block = 1e30, shared = 1e30;
+        double sum1 = 0, sum2 = 0;
+        for (int r = 0; r < repeats; r++) {
+            auto result = per_block_setup(data, dims, block_size);
+            per_block = std::min(per_block, result.seconds);
+            sum1 = result.checksum;
+            result = compressor_setup(data, dims, block_size);
+            shared = std::min(shared, result.seconds);
+            sum2 = result.checksum;
+        }
+        printf("block size = %2zu: new range per block = %.3f ns/element, compressor = %.3f ns/element%s\n",
+               block_size, per_block * 1e9 / num, shared * 1e9 / num, sum1 == sum2 ? "" : " (mismatch)");
+    }
+    return 0;
+}
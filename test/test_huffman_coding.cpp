@@ -14,8 +14,10 @@ int main() {
 
     unsigned char *compressed = (unsigned char *) malloc(N * sizeof(int));
     {
-        SZ::HuffmanEncoder<int> encoder;
-        encoder.preprocess_encode(type, 2 * capacity);
+        SZ::HuffmanEncoder<int> built;
+        built.preprocess_encode(type, 2 * capacity);
+        // a moved-to encoder takes the built tree
+        SZ::HuffmanEncoder<int> encoder(std::move(built));
         unsigned char *compressed_pos = compressed;
         cout << "save encoder" << endl;
         encoder.save(compressed_pos);
@@ -35,11 +37,13 @@ int main() {
         // }
     }
     {
-        SZ::HuffmanEncoder<int> encoder;
+        SZ::HuffmanEncoder<int> loaded;
         const unsigned char *compressed_pos = compressed;
         size_t length = sizeof(int);
         cout << "load" << endl;
-        encoder.load(compressed_pos, length);
+        loaded.load(compressed_pos, length);
+        SZ::HuffmanEncoder<int> encoder;
+        encoder = std::move(loaded);
         cout << compressed_pos - compressed << endl;
         auto dec_type = encoder.decode(compressed_pos, N);
         for (int i = 0; i < N; i++) {
@@ -49,6 +53,12 @@ int main() {
             }
         }
         encoder.postprocess_decode();
+        // a copy-assigned encoder drops its tree, like a copy-constructed one
+        encoder = loaded;
+        if (encoder.isLoaded()) {
+            cout << "copy-assigned encoder kept its tree\n";
+            exit(1);
+        }
     }
     free(compressed);
 